@@ -0,0 +1,269 @@
+#ifndef _WIN32
+// cpu affinity and sched_getcpu()
+#define _GNU_SOURCE
+#endif
+
+#include "batch.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "thread.h"
+
+#ifdef _WIN32
+static void pinTo(int cpu) {
+    SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR) 1 << cpu);
+}
+
+static int currentCpu() {
+    return (int) GetCurrentProcessorNumber();
+}
+
+int cpuNode(int cpu) {
+    UCHAR node;
+    return GetNumaProcessorNode((UCHAR) cpu, &node) ? node : 0;
+}
+#else
+static void pinTo(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+static int currentCpu() {
+    int cpu = sched_getcpu();
+    return cpu < 0 ? 0 : cpu;
+}
+
+// a cpu's sysfs directory has a nodeN link for the node it is on
+int cpuNode(int cpu) {
+    char path[64];
+    for (int node = 0; node < 64; node++) {
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/node%d", cpu, node);
+        if (access(path, F_OK) == 0) return node;
+    }
+    return 0;
+}
+#endif
+
+void batchInit(batch_t* b, int count, int width, int height) {
+    b->count = count;
+    b->width = width;
+    b->height = height;
+    b->worlds = calloc(count, sizeof(world_t));
+    b->jobs = malloc(count * sizeof(batch_job_t));
+    b->results = calloc(count, sizeof(batch_result_t));
+    b->placement = true;
+    b->owner = malloc(count * sizeof(int));
+    b->node = calloc(count, sizeof(int));
+    b->taken = calloc(count, sizeof(int));
+    for (int i = 0; i < count; i++) {
+        b->jobs[i] = (batch_job_t) { i + 1, 4, COLOR_PERCENT, 0 };
+        b->owner[i] = -1;
+    }
+    b->migrations = 0;
+    b->remote = 0;
+    b->steals = 0;
+}
+
+void batchFree(batch_t* b) {
+    for (int i = 0; i < b->count; i++) {
+        if (b->worlds[i].cells) worldFree(&b->worlds[i]);
+    }
+    free(b->worlds);
+    free(b->jobs);
+    free(b->results);
+    free(b->owner);
+    free(b->node);
+    free(b->taken);
+}
+
+// worlds a worker runs first. its own worker takes them from the front, others that
+// have run out of their own take them from the back
+typedef struct queue {
+    int* worlds;
+    int length;
+    int front;
+    int back;
+} queue_t;
+
+typedef struct worker {
+    batch_t* b;
+    int index;
+    int cpu;
+    queue_t* queues;
+    int count;
+    // memory node of every cpu
+    const int* nodes;
+    int cpus;
+} worker_t;
+
+static void runWorld(const worker_t* self, int index) {
+    batch_t* b = self->b;
+    world_t* w = &b->worlds[index];
+    const batch_job_t* job = &b->jobs[index];
+    batch_result_t* r = &b->results[index];
+
+    // allocated by the worker that steps it, so its memory stays local to that worker
+    int cpu = currentCpu();
+    int node = cpu < self->cpus ? self->nodes[cpu] : cpuNode(cpu);
+    if (!w->cells) {
+        worldInit(w, b->width, b->height, job->seed);
+        b->node[index] = node;
+    } else {
+        worldClear(w);
+        w->seed = job->seed;
+        w->step = 0;
+        w->colorPercent = 0.0;
+        w->colorDirection = 1;
+    }
+    w->colorRate = job->colorRate;
+    if (b->owner[index] >= 0 && b->owner[index] != self->index) atomicAdd(&b->migrations, 1);
+    if (node != b->node[index]) atomicAdd(&b->remote, 1);
+    b->owner[index] = self->index;
+
+    r->settledStep = -1;
+    for (int s = 0; s < b->steps; s++) {
+        if (s < job->pourSteps) pour(w, job->brushRadius);
+        int moved = UpdateGrid(w);
+        if (s >= job->pourSteps && moved == 0) {
+            r->settledStep = s;
+            break;
+        }
+    }
+
+    r->grains = countGrains(w);
+    r->pileHeight = 0;
+    r->pileWidth = 0;
+    for (int j = 0; j < w->width; j++) {
+        if (w->surface[j] == w->height) continue;
+        r->pileWidth++;
+        if (w->height - w->surface[j] > r->pileHeight) r->pileHeight = w->height - w->surface[j];
+    }
+    r->hash = hashWorld(w);
+}
+
+static bool take(batch_t* b, int world) {
+    return atomicSwap(&b->taken[world], 0, 1);
+}
+
+static void* sharedWorker(void* param) {
+    worker_t* self = param;
+    batch_t* b = self->b;
+    for (;;) {
+        int index = atomicAdd(&b->next, 1);
+        if (index >= b->count) break;
+        runWorld(self, index);
+    }
+    return NULL;
+}
+
+static void* placedWorker(void* param) {
+    worker_t* self = param;
+    batch_t* b = self->b;
+    pinTo(self->cpu);
+
+    queue_t* own = &self->queues[self->index];
+    for (;;) {
+        int i = atomicAdd(&own->front, 1);
+        if (i >= own->length) break;
+        if (take(b, own->worlds[i])) runWorld(self, own->worlds[i]);
+    }
+    // steal from whichever queue has the most left, so the last worlds end up spread out
+    for (;;) {
+        queue_t* victim = NULL;
+        int most = 0;
+        for (int q = 0; q < self->count; q++) {
+            int left = atomicLoad(&self->queues[q].back) - atomicLoad(&self->queues[q].front);
+            if (left > most) {
+                most = left;
+                victim = &self->queues[q];
+            }
+        }
+        if (!victim) break;
+        int i = atomicAdd(&victim->back, -1) - 1;
+        if (i < 0 || !take(b, victim->worlds[i])) continue;
+        atomicAdd(&b->steals, 1);
+        runWorld(self, victim->worlds[i]);
+    }
+    return NULL;
+}
+
+// without placement worlds are handed out whole, one at a time, to whichever worker
+// asks next, so a small world stays in its worker's cache for every update of its run
+// and uneven settling times balance out.
+//
+// with placement every worker is pinned to a cpu of its own and starts on a queue of
+// the worlds it ran last time, so a world is stepped where its memory was first
+// touched. a worker whose queue runs dry steals from the back of the fullest one, and
+// a stolen world then belongs to the thief
+void batchRun(batch_t* b, int steps, int threads) {
+    b->next = 0;
+    b->steps = steps;
+    b->migrations = 0;
+    b->remote = 0;
+    b->steals = 0;
+    if (threads < 1) threads = 1;
+    if (threads > b->count) threads = b->count;
+
+    worker_t* workers = malloc(threads * sizeof(worker_t));
+    queue_t* queues = calloc(threads, sizeof(queue_t));
+    int* order = malloc(b->count * sizeof(int));
+    if (b->placement) {
+        // worlds new to this many workers are split into even runs of neighbours
+        int* home = malloc(b->count * sizeof(int));
+        for (int i = 0; i < b->count; i++) {
+            int owner = b->owner[i];
+            home[i] = owner >= 0 && owner < threads ? owner : (int) ((long long) i * threads / b->count);
+            queues[home[i]].length++;
+            b->taken[i] = 0;
+        }
+        int start = 0;
+        for (int t = 0; t < threads; t++) {
+            queues[t].worlds = order + start;
+            start += queues[t].length;
+            queues[t].back = queues[t].length;
+            queues[t].length = 0;
+        }
+        for (int i = 0; i < b->count; i++) {
+            queue_t* q = &queues[home[i]];
+            q->worlds[q->length++] = i;
+        }
+        free(home);
+    }
+
+    int cpus = cpuCount();
+    int* nodes = malloc(cpus * sizeof(int));
+    for (int c = 0; c < cpus; c++) {
+        nodes[c] = cpuNode(c);
+    }
+    thread_t* pool = malloc(threads * sizeof(thread_t));
+    bool* started = calloc(threads, sizeof(bool));
+    for (int t = 0; t < threads; t++) {
+        workers[t] = (worker_t) { b, t, t % cpus, queues, threads, nodes, cpus };
+    }
+    // with placement the calling thread is left unpinned and only waits
+    void* (*fn)(void*) = b->placement ? placedWorker : sharedWorker;
+    int first = b->placement ? 0 : 1;
+    for (int t = first; t < threads; t++) {
+        started[t] = threadStart(&pool[t], fn, &workers[t]);
+    }
+    if (!b->placement) sharedWorker(&workers[0]);
+    for (int t = first; t < threads; t++) {
+        if (started[t]) threadJoin(&pool[t]);
+    }
+    // a worker that never started leaves its queue to be stolen by the rest, or run here
+    if (b->placement) {
+        for (int i = 0; i < b->count; i++) {
+            if (take(b, i)) runWorld(&workers[0], i);
+        }
+    }
+
+    free(nodes);
+    free(started);
+    free(pool);
+    free(order);
+    free(queues);
+    free(workers);
+}
@@ -0,0 +1,66 @@
+#ifndef SANDSIM_BATCH_H
+#define SANDSIM_BATCH_H
+
+#include "sim.h"
+
+// parameters of one sandbox in a sweep
+typedef struct batch_job {
+    uint32_t seed;
+    // radius of the brush pouring at the top center
+    int brushRadius;
+    // gradient color change per grain
+    float colorRate;
+    // updates spent pouring before the pile is left to settle
+    int pourSteps;
+} batch_job_t;
+
+// summary of a sandbox after its run
+typedef struct batch_result {
+    int grains;
+    // first update after pouring where nothing moved, -1 if it never settled
+    int settledStep;
+    // rows from the floor to the highest surface
+    int pileHeight;
+    // columns holding at least one grain
+    int pileWidth;
+    uint64_t hash;
+} batch_result_t;
+
+// many independent worlds stepped together
+typedef struct batch {
+    int count;
+    int width;
+    int height;
+    world_t* worlds;
+    batch_job_t* jobs;
+    batch_result_t* results;
+    // next world a worker picks up, without placement
+    int next;
+    int steps;
+
+    // pin workers to cpus and keep every world on the worker that allocated it, see batchRun()
+    bool placement;
+    // worker each world was last run by, -1 before its first run
+    int* owner;
+    // memory node each world was allocated on
+    int* node;
+    // set once a worker has taken a world in the current run
+    int* taken;
+
+    // counts for the last run: worlds run by another worker than last time, worlds run
+    // on another node than their memory is on, and worlds taken from another worker's queue
+    int migrations;
+    int remote;
+    int steals;
+} batch_t;
+
+// allocates count worlds with default jobs seeded 1..count
+void batchInit(batch_t* b, int count, int width, int height);
+void batchFree(batch_t* b);
+// resets every world from its job and runs it for steps updates on threads workers
+void batchRun(batch_t* b, int steps, int threads);
+
+// memory node cpu belongs to, 0 where that can't be told
+int cpuNode(int cpu);
+
+#endif
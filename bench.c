@@ -0,0 +1,1242 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "batch.h"
+#include "checkpoint.h"
+#include "domain.h"
+#include "edit.h"
+#include "flow.h"
+#include "governor.h"
+#include "heat.h"
+#include "history.h"
+#include "margolus.h"
+#include "mip.h"
+#include "net.h"
+#include "scene.h"
+#include "share.h"
+#include "sim.h"
+#include "stats.h"
+#include "stream.h"
+#include "thread.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+static double now() {
+    LARGE_INTEGER count, frequency;
+    QueryPerformanceCounter(&count);
+    QueryPerformanceFrequency(&frequency);
+    return (double) count.QuadPart / frequency.QuadPart;
+}
+#else
+#include <time.h>
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+#endif
+
+// bench parameters
+int size = 0;
+int steps = 200;
+unsigned seed = 1;
+int threads = 0;
+
+// empty the grid and scatter grains over its top half
+static void fillNoise(world_t* w, float density) {
+    srand(seed);
+    worldClear(w);
+    w->step = 0;
+    for (int i = 0; i < w->height / 2; i++) {
+        for (int j = 0; j < w->width; j++) {
+            if (rand() < density * RAND_MAX) {
+                set(w, i, j, (particle_t) { RGB(j, i, 0), true, false, 0 });
+            }
+        }
+    }
+}
+
+static double timeSteps(world_t* w, bool track) {
+    w->trackSurface = track;
+    fillNoise(w, 0.3f);
+    double start = now();
+    for (int s = 0; s < steps; s++) {
+        UpdateGrid(w);
+    }
+    return (now() - start) / steps;
+}
+
+// random fill/clear churn, the raw cost of keeping the surfaces current
+static double timeChurn(world_t* w, bool track, int ops) {
+    w->trackSurface = track;
+    fillNoise(w, 0.3f);
+    srand(seed + 1);
+    double start = now();
+    for (int k = 0; k < ops; k++) {
+        int i = rand() % w->height;
+        int j = rand() % w->width;
+        set(w, i, j, at(w, i, j).e ? EMPTY : (particle_t) { RGB(255, 255, 255), true, false, 0 });
+    }
+    return (now() - start) / ops;
+}
+
+static void benchSurface() {
+    world_t world;
+    world_t* w = &world;
+    worldInit(w, size ? size : 1024, size ? size : 1024, seed);
+    printf("surface maintenance, %dx%d, %d steps\n", w->width, w->height, steps);
+
+    double tracked = timeSteps(w, true);
+    double untracked = timeSteps(w, false);
+    printf("  %-24s %10.3f ms\n", "step, tracked", tracked * 1e3);
+    printf("  %-24s %10.3f ms\n", "step, untracked", untracked * 1e3);
+
+    int ops = 1 << 20;
+    double churnTracked = timeChurn(w, true, ops);
+    double churnUntracked = timeChurn(w, false, ops);
+    printf("  %-24s %10.2f ns\n", "set(), tracked", churnTracked * 1e9);
+    printf("  %-24s %10.2f ns\n", "set(), untracked", churnUntracked * 1e9);
+
+    w->trackSurface = true;
+    double start = now();
+    rebuildSurface(w);
+    printf("  %-24s %10.3f ms\n", "full rebuild", (now() - start) * 1e3);
+    worldFree(w);
+}
+
+// worlds x cells x updates a run of b stepped, worlds that settled stop counting
+static long long cellSteps(const batch_t* b, int steps) {
+    long long total = 0;
+    for (int i = 0; i < b->count; i++) {
+        int ran = b->results[i].settledStep < 0 ? steps : b->results[i].settledStep + 1;
+        total += (long long) ran * b->width * b->height;
+    }
+    return total;
+}
+
+// rounds of the whole batch on threads workers, each world starting over every round.
+// the first round allocates the worlds, the rest are measured
+static void scaling(int count, int side, int workers, bool placement) {
+    enum { ROUNDS = 3 };
+    batch_t b;
+    batchInit(&b, count, side, side);
+    b.placement = placement;
+    for (int i = 0; i < count; i++) {
+        b.jobs[i].seed = seed + i;
+        b.jobs[i].pourSteps = steps / 2;
+    }
+    batchRun(&b, steps, workers);
+    double elapsed = 0;
+    long long cells = 0;
+    int migrations = 0, remote = 0, steals = 0;
+    for (int r = 1; r < ROUNDS; r++) {
+        double start = now();
+        batchRun(&b, steps, workers);
+        elapsed += now() - start;
+        cells += cellSteps(&b, steps);
+        migrations += b.migrations;
+        remote += b.remote;
+        steals += b.steals;
+    }
+    printf("  %-10s %7d %12.1f %11d %11d %8d\n", placement ? "placed" : "shared", workers, cells / elapsed * 1e-6,
+           migrations, remote, steals);
+    batchFree(&b);
+}
+
+static void benchBatch(int count, int policy) {
+    int side = size ? size : 128;
+    int workers = threads ? threads : cpuCount();
+    batch_t b;
+    batchInit(&b, count, side, side);
+    // sweep brush radius and gradient speed across the batch
+    for (int i = 0; i < count; i++) {
+        b.jobs[i].seed = seed + i;
+        b.jobs[i].brushRadius = 2 + i % 8;
+        b.jobs[i].colorRate = 0.0005f * (1 + i / 8 % 8);
+        b.jobs[i].pourSteps = steps / 2;
+    }
+
+    // the same sweep on one thread first, which is what one process per sandbox gets at best
+    double start = now();
+    batchRun(&b, steps, 1);
+    double serialTime = now() - start;
+
+    start = now();
+    batchRun(&b, steps, workers);
+    double batchTime = now() - start;
+
+    printf("batch of %d worlds, %dx%d, up to %d steps, %d threads\n", count, side, side, steps, workers);
+    printf("  %6s %6s %6s %8s %8s %7s %7s %16s\n", "world", "seed", "brush", "rate", "grains", "settled", "height", "hash");
+    for (int i = 0; i < count && i < 16; i++) {
+        const batch_result_t* r = &b.results[i];
+        printf("  %6d %6u %6d %8.4f %8d %7d %7d %016llx\n", i, b.jobs[i].seed, b.jobs[i].brushRadius,
+               b.jobs[i].colorRate, r->grains, r->settledStep, r->pileHeight, (unsigned long long) r->hash);
+    }
+    long long cells = cellSteps(&b, steps);
+    printf("  %-24s %10.1f Mcells/s\n", "1 thread", cells / serialTime * 1e-6);
+    printf("  %-24s %10.1f Mcells/s\n", "batch aggregate", cells / batchTime * 1e-6);
+    batchFree(&b);
+
+    // placement against handing worlds to whichever worker asks, at doubling thread counts.
+    // remote runs are worlds stepped on another memory node than they were allocated on,
+    // by where the worker was running when it started the world
+    int nodes = 0;
+    for (int c = 0; c < cpuCount(); c++) {
+        if (cpuNode(c) + 1 > nodes) nodes = cpuNode(c) + 1;
+    }
+    printf("worker placement, %d cpus on %d memory nodes, 2 measured rounds\n", cpuCount(), nodes);
+    printf("  %-10s %7s %12s %11s %11s %8s\n", "policy", "threads", "Mcells/s", "migrations", "remote runs",
+           "steals");
+    for (int t = 1;; t *= 2) {
+        if (t > workers) t = workers;
+        if (policy != 1) scaling(count, side, t, false);
+        if (policy != 0) scaling(count, side, t, true);
+        if (t == workers) break;
+    }
+}
+
+// hardware counters around a run, where the platform lets us read them
+enum { INSTRUCTIONS, BRANCHES, BRANCH_MISSES, COUNTERS };
+
+typedef struct counters {
+    int fd[COUNTERS];
+    long long value[COUNTERS];
+} counters_t;
+
+static void countersStart(counters_t* c) {
+    for (int k = 0; k < COUNTERS; k++) {
+        c->fd[k] = -1;
+        c->value[k] = -1;
+    }
+#ifdef __linux__
+    const uint64_t configs[COUNTERS] = {
+        PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES
+    };
+    for (int k = 0; k < COUNTERS; k++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = configs[k];
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        c->fd[k] = (int) syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+        if (c->fd[k] >= 0) {
+            ioctl(c->fd[k], PERF_EVENT_IOC_RESET, 0);
+            ioctl(c->fd[k], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#endif
+}
+
+static void countersStop(counters_t* c) {
+#ifdef __linux__
+    for (int k = 0; k < COUNTERS; k++) {
+        if (c->fd[k] < 0) continue;
+        ioctl(c->fd[k], PERF_EVENT_IOC_DISABLE, 0);
+        if (read(c->fd[k], &c->value[k], sizeof(long long)) != sizeof(long long)) c->value[k] = -1;
+        close(c->fd[k]);
+    }
+#else
+    (void) c;
+#endif
+}
+
+// per-cell figure, or n/a when the counter was unavailable
+static void printPerCell(long long value, double cells) {
+    if (value < 0) {
+        printf(" %10s", "n/a");
+    } else {
+        printf(" %10.2f", value / cells);
+    }
+}
+
+static void benchKernels() {
+    world_t world;
+    world_t* w = &world;
+    worldInit(w, size ? size : 1024, size ? size : 1024, seed);
+    printf("step kernels, %dx%d, %d steps\n", w->width, w->height, steps);
+    printf("  %-16s %10s %10s %10s %10s %10s %18s\n", "kernel", "ms/step", "ns/cell", "instr/cell", "br/cell",
+           "miss/cell", "hash");
+
+    for (int k = 0; k < KERNEL_COUNT; k++) {
+        const kernel_info_t* info = &KERNELS[k];
+        if (info->width && (info->width != w->width || info->height != w->height)) continue;
+
+        w->kernel = info->step;
+        fillNoise(w, 0.3f);
+        counters_t c;
+        countersStart(&c);
+        double start = now();
+        for (int s = 0; s < steps; s++) {
+            UpdateGrid(w);
+        }
+        double elapsed = now() - start;
+        countersStop(&c);
+
+        double cells = (double) w->width * w->height * steps;
+        printf("  %-16s %10.3f %10.3f", info->name, elapsed / steps * 1e3, elapsed / cells * 1e9);
+        for (int m = 0; m < COUNTERS; m++) {
+            printPerCell(c.value[m], cells);
+        }
+        printf(" %016llx\n", (unsigned long long) hashWorld(w));
+    }
+    worldFree(w);
+}
+
+// pours into a world and streams it to spectators: a keyframe when one connects,
+// then a delta of the written chunks after every update, every FRAME_HASH_EVERY-th of
+// them hashed
+static void serve(const char* address, int port) {
+    world_t world;
+    world_t* w = &world;
+    worldInit(w, size ? size : 512, size ? size : 512, seed);
+
+    net_socket_t listener = netListen(address, port);
+    if (listener == NET_INVALID) {
+        fprintf(stderr, "can't listen on %s port %d\n", address ? address : "loopback", port);
+        exit(1);
+    }
+    printf("serving on %s port %d, waiting for a spectator\n", address ? address : "loopback", port);
+    fflush(stdout);
+
+    enum { MAX_SPECTATORS = 16 };
+    net_socket_t spectators[MAX_SPECTATORS];
+    int count = 0;
+    buffer_t frame = { 0 };
+    uint32_t since = nextEpoch(w);
+    size_t keyBytes = 0, deltaBytes = 0;
+    int deltas = 0;
+
+    for (int s = 0; s < steps; s++) {
+        // block for the first spectator, then just check for new ones
+        net_socket_t joined;
+        while ((joined = netAccept(listener, count ? 0 : 1000)) != NET_INVALID || count == 0) {
+            if (joined == NET_INVALID) continue;
+            frame.size = 0;
+            encodeKeyframe(w, &frame);
+            keyBytes = frame.size;
+            if (count < MAX_SPECTATORS && netSend(joined, frame.data, frame.size)) {
+                spectators[count++] = joined;
+            } else {
+                netClose(joined);
+            }
+        }
+
+        if (s < steps / 2) pour(w, 8);
+        UpdateGrid(w);
+
+        frame.size = 0;
+        encodeDelta(w, since, (deltas + 1) % FRAME_HASH_EVERY == 0, &frame);
+        since = nextEpoch(w);
+        deltaBytes += frame.size;
+        deltas++;
+        for (int k = 0; k < count; k++) {
+            if (!netSend(spectators[k], frame.data, frame.size)) {
+                netClose(spectators[k]);
+                spectators[k--] = spectators[--count];
+            }
+        }
+    }
+
+    printf("streamed %d updates of a %dx%d world\n", deltas, w->width, w->height);
+    printf("  %-24s %10zu bytes\n", "raw world", (size_t) w->width * w->height * sizeof(uint32_t));
+    printf("  %-24s %10zu bytes\n", "keyframe", keyBytes);
+    printf("  %-24s %10.0f bytes\n", "mean delta", (double) deltaBytes / deltas);
+    for (int k = 0; k < count; k++) {
+        netClose(spectators[k]);
+    }
+    netClose(listener);
+    bufferFree(&frame);
+    worldFree(w);
+}
+
+// step times with and without a checkpoint being written in the background every few
+// updates. the last checkpoint is read back and has to match the world it was taken of
+static bool benchCheckpoint(int every) {
+    const char* path = "sandsim_bench.checkpoint";
+    world_t world;
+    world_t* w = &world;
+    worldInit(w, size ? size : 1024, size ? size : 1024, seed);
+    printf("checkpoints, %dx%d, %d steps, one every %d\n", w->width, w->height, steps, every);
+    printf("  %-24s %10s %10s %8s %8s\n", "", "mean ms", "max ms", "saved", "copied");
+
+    bool match = true;
+    for (int pass = 0; pass < 2; pass++) {
+        fillNoise(w, 0.3f);
+        double total = 0, worst = 0;
+        int saved = 0, copied = 0;
+        uint64_t hash = 0;
+        for (int s = 0; s < steps; s++) {
+            if (w->checkpoint && !checkpointBusy(w)) {
+                copied += checkpointEnd(w);
+                saved++;
+            }
+            // hashing is only there to check the file, keep it out of the timings
+            bool begin = pass == 1 && s % every == 0 && !w->checkpoint;
+            uint64_t before = begin ? hashWorld(w) : 0;
+
+            double start = now();
+            if (begin && checkpointBegin(w, path)) hash = before;
+            if (s < steps / 2) pour(w, 8);
+            UpdateGrid(w);
+            double elapsed = now() - start;
+            total += elapsed;
+            if (elapsed > worst) worst = elapsed;
+        }
+        if (w->checkpoint) {
+            copied += checkpointEnd(w);
+            saved++;
+        }
+        printf("  %-24s %10.3f %10.3f %8d %8d\n", pass ? "checkpointing" : "no checkpoints", total / steps * 1e3,
+               worst * 1e3, saved, copied);
+
+        if (saved) {
+            world_t loaded;
+            match = checkpointLoad(&loaded, path) && hashWorld(&loaded) == hash;
+            if (match) worldFree(&loaded);
+            printf("  last checkpoint %s\n", match ? "reloads" : "MISMATCH");
+        }
+    }
+    remove(path);
+    worldFree(w);
+    return match;
+}
+
+// frame cost of drawing a world into a 1000x1000 window, fitted whole and zoomed to
+// 2 cells per pixel: keeping the on screen part of the pyramid current plus one
+// lookup per pixel, against touching every cell once
+static void benchRender() {
+    static const int SIZES[] = { 256, 1024, 4096 };
+    enum { FRAME = 1000 };
+    uint32_t* pixels = malloc(FRAME * FRAME * sizeof(uint32_t));
+    printf("rendering into %dx%d, %d frames\n", FRAME, FRAME, steps);
+    printf("  %-12s %-8s %10s %10s %10s %10s\n", "world", "view", "step ms", "mip ms", "render ms", "scan ms");
+
+    for (int s = 0; s < 3; s++) {
+        int n = size ? size : SIZES[s];
+        for (int zoomed = 0; zoomed < 2; zoomed++) {
+            world_t world;
+            world_t* w = &world;
+            worldInit(w, n, n, seed);
+            fillNoise(w, 0.3f);
+            camera_t camera = zoomed ? (camera_t) { n / 4.0, n / 4.0, 2 } : cameraFit(n, n, FRAME, FRAME);
+            mip_t m;
+            mipInit(&m, w);
+            mipUpdateView(&m, w, camera, FRAME, FRAME);
+
+            double stepTime = 0, mipTime = 0, renderTime = 0, scanTime = 0;
+            bool counted = true;
+            for (int f = 0; f < steps; f++) {
+                double start = now();
+                UpdateGrid(w);
+                double stepped = now();
+                mipUpdateView(&m, w, camera, FRAME, FRAME);
+                double reduced = now();
+                mipRender(&m, w, camera, pixels, FRAME, FRAME, RGB(0, 0, 0));
+                double rendered = now();
+                // the least a per-cell renderer has to do: read every cell once. the
+                // filled ones are counted so the reads can't be left out
+                int filled = 0;
+                for (int i = 0; i < n; i++) {
+                    const particle_t* row = &w->cells[cellIndex(w, i, 0)];
+                    for (int j = 0; j < n; j++) {
+                        filled += row[j].e;
+                    }
+                }
+                counted = counted && filled == countGrains(w);
+                double scanned = now();
+                stepTime += stepped - start;
+                mipTime += reduced - stepped;
+                renderTime += rendered - reduced;
+                scanTime += scanned - rendered;
+            }
+            char name[32];
+            snprintf(name, sizeof(name), "%dx%d", n, n);
+            printf("  %-12s %-8s %10.3f %10.3f %10.3f %10.3f\n", name, zoomed ? "2 cell" : "fit",
+                   stepTime / steps * 1e3, mipTime / steps * 1e3, renderTime / steps * 1e3, scanTime / steps * 1e3);
+            if (!counted) printf("  scan counted different grains than the world holds\n");
+            mipFree(&m);
+            worldFree(w);
+        }
+        if (size) break;
+    }
+    free(pixels);
+}
+
+// a tall world poured into from the top, stepped as a grid alone and with the falling
+// grains lifted out of it. both have to end up with the same world
+static bool benchAirborne() {
+    int side = size ? size : 512;
+    uint64_t hashes[2];
+    printf("airborne grains, %dx%d, %d steps pouring\n", side, side * 4, steps);
+    for (int lift = 0; lift < 2; lift++) {
+        world_t world;
+        world_t* w = &world;
+        worldInit(w, side, side * 4, seed);
+        w->liftAirborne = lift;
+        long long lifted = 0;
+        double start = now();
+        for (int s = 0; s < steps; s++) {
+            pour(w, 12);
+            UpdateGrid(w);
+            lifted += w->airborne.count;
+        }
+        double elapsed = now() - start;
+        hashes[lift] = hashWorld(w);
+        printf("  %-24s %10.3f ms %10.1f lifted/step\n", lift ? "grid + particle list" : "grid", elapsed / steps * 1e3,
+               (double) lifted / steps);
+        worldFree(w);
+    }
+    bool match = hashes[0] == hashes[1];
+    printf("  %s\n", match ? "match" : "MISMATCH");
+    return match;
+}
+
+// every standard scene at a few sizes. the hash column is the world after the last
+// update, so a row whose hash changed between two releases measures something else
+static void benchSuite() {
+    static const int SIZES[] = { 256, 1024 };
+    printf("scene suite, %d steps, seed %u\n", steps, seed);
+    printf("  %-10s %-10s %9s %11s %10s %9s  %s\n", "scene", "world", "grains", "moved/step", "ms/step", "ns/cell",
+           "hash");
+    for (int t = 0; t < SCENE_TYPE_COUNT; t++) {
+        const scene_type_t* scene = &SCENE_TYPES[t];
+        for (int s = 0; s < 2; s++) {
+            int n = size ? size : SIZES[s];
+            world_t w;
+            sceneCreate(&w, scene, n, n, seed);
+            long long moved = 0;
+            double start = now();
+            for (int i = 0; i < steps; i++) {
+                moved += sceneStep(&w, scene);
+            }
+            double elapsed = (now() - start) / steps;
+            char name[32];
+            snprintf(name, sizeof(name), "%dx%d", n, n);
+            printf("  %-10s %-10s %9d %11.0f %10.3f %9.3f  %016llx\n", scene->name, name, countGrains(&w),
+                   (double) moved / steps, elapsed * 1e3, elapsed / ((double) n * n) * 1e9,
+                   (unsigned long long) hashWorld(&w));
+            worldFree(&w);
+            if (size) break;
+        }
+    }
+}
+
+// every standard scene swept row by row and stepped from the active list, which must agree
+static bool benchWorklist() {
+    int n = size ? size : 1024;
+    bool match = true;
+    printf("sweep against worklist, %dx%d, %d steps\n", n, n, steps);
+    printf("  %-10s %11s %12s %12s %10s\n", "scene", "moved/step", "sweep ms", "worklist ms", "speedup");
+    for (int t = 0; t < SCENE_TYPE_COUNT; t++) {
+        const scene_type_t* scene = &SCENE_TYPES[t];
+        double ms[2];
+        uint64_t hash[2];
+        long long moved = 0;
+        for (int list = 0; list < 2; list++) {
+            world_t w;
+            sceneCreate(&w, scene, n, n, seed);
+            w.worklist = list;
+            moved = 0;
+            double start = now();
+            for (int i = 0; i < steps; i++) {
+                moved += sceneStep(&w, scene);
+            }
+            ms[list] = (now() - start) / steps * 1e3;
+            hash[list] = hashWorld(&w);
+            worldFree(&w);
+        }
+        match = match && hash[0] == hash[1];
+        printf("  %-10s %11.0f %12.3f %12.3f %9.1fx%s\n", scene->name, (double) moved / steps, ms[0], ms[1],
+               ms[0] / ms[1], hash[0] == hash[1] ? "" : "  MISMATCH");
+    }
+    return match;
+}
+
+// recording every update of each standard scene, then stepping back over it and
+// replaying it, under a limit of megabytes with a keyframe every keyEvery frames
+static bool benchHistory(int megabytes, int keyEvery) {
+    int n = size ? size : 512;
+    size_t limit = (size_t) megabytes << 20;
+    bool match = true;
+    printf("history of %dx%d, %d steps, a keyframe every %d, %d MB limit\n", n, n, steps, keyEvery, megabytes);
+    printf("  %-10s %10s %10s %10s %10s %8s %10s %10s %9s\n", "scene", "update ms", "record ms", "key KB", "delta B",
+           "frames", "back ms", "replay ms", "held MB");
+    for (int t = 0; t < SCENE_TYPE_COUNT; t++) {
+        const scene_type_t* scene = &SCENE_TYPES[t];
+        world_t w;
+        sceneCreate(&w, scene, n, n, seed);
+        history_t h;
+        historyInit(&h, &w, limit, keyEvery);
+        double update = 0, record = 0;
+        for (int i = 0; i < steps; i++) {
+            double start = now();
+            sceneStep(&w, scene);
+            double middle = now();
+            historyRecord(&h, &w);
+            update += middle - start;
+            record += now() - middle;
+        }
+        uint64_t hash = hashWorld(&w);
+        int frames = h.count;
+        size_t keyBytes = 0, deltaBytes = 0;
+        int keys = 0;
+        for (int i = 0; i < h.count; i++) {
+            const history_frame_t* f = &h.frames[(h.first + i) % h.capacity];
+            keys += f->key;
+            *(f->key ? &keyBytes : &deltaBytes) += f->size;
+        }
+
+        // a step at a time back to the oldest frame, then forward again
+        uint32_t newest = historyNewest(&h), oldest = historyOldest(&h);
+        double start = now();
+        for (uint32_t s = newest; s-- > oldest;) {
+            historySeek(&h, &w, s);
+        }
+        double back = (now() - start) / (newest - oldest + 1);
+        start = now();
+        for (uint32_t s = oldest + 1; s <= newest; s++) {
+            historySeek(&h, &w, s);
+        }
+        double replay = (now() - start) / (newest - oldest + 1);
+        match = match && hashWorld(&w) == hash;
+
+        printf("  %-10s %10.3f %10.3f %10.1f %10.0f %8d %10.3f %10.3f %9.1f%s\n", scene->name, update / steps * 1e3,
+               record / steps * 1e3, keyBytes / 1024.0 / keys, frames > keys ? (double) deltaBytes / (frames - keys) : 0.0, frames,
+               back * 1e3, replay * 1e3, historyMemory(&h) / 1048576.0, hashWorld(&w) == hash ? "" : "  MISMATCH");
+        historyFree(&h);
+        worldFree(&w);
+    }
+    return match;
+}
+
+// frames of the avalanche scene drawn into a 1000x1000 frame, presented every budget ms.
+// without the governor every owed update runs, with it the frame is held to the budget
+static void benchGovernor(double budget) {
+    enum { FRAME = 1000 };
+    int n = size ? size : 1024;
+    const scene_type_t* scene = findScene("avalanche");
+    uint32_t* pixels = malloc(FRAME * FRAME * sizeof(uint32_t));
+    printf("frame governor, avalanche %dx%d, %.1f ms frames, 220 updates/s, %d frames\n", n, n, budget, steps);
+    printf("  %-10s %10s %10s %10s %10s %10s\n", "", "mean ms", "worst ms", "over", "updates", "reduced");
+
+    for (int governed = 0; governed < 2; governed++) {
+        world_t world;
+        world_t* w = &world;
+        sceneCreate(w, scene, n, n, seed);
+        camera_t camera = cameraFit(n, n, FRAME, FRAME);
+        mip_t m;
+        mipInit(&m, w);
+        governor_t g;
+        governorInit(&g, budget / 1e3, 220, 16);
+        if (governed) g.log = stdout;
+
+        double total = 0, worst = 0;
+        int over = 0, reduced = 0;
+        long updates = 0;
+        for (int f = 0; f < steps; f++) {
+            double start = now();
+            int substeps;
+            if (governed) {
+                substeps = governorPlan(&g, budget / 1e3);
+            } else {
+                // everything owed, at full quality
+                g.owed += budget / 1e3 * g.stepRate;
+                substeps = (int) g.owed;
+                g.owed -= substeps;
+            }
+            for (int s = 0; s < substeps; s++) {
+                sceneStep(w, scene);
+            }
+            double stepped = now();
+            governorStepped(&g, substeps, stepped - start);
+
+            camera_t view = camera;
+            int side = FRAME;
+            bool quality = !governorReduced(&g);
+            if (!quality) {
+                view.scale *= 2;
+                side /= 2;
+            }
+            mipUpdateView(&m, w, view, side, side);
+            mipRender(&m, w, view, pixels, side, side, RGB(0, 0, 0));
+            double end = now();
+            governorRendered(&g, !quality, end - stepped);
+
+            total += end - start;
+            if (end - start > worst) worst = end - start;
+            over += end - start > budget / 1e3;
+            reduced += !quality;
+            updates += substeps;
+        }
+        printf("  %-10s %10.3f %10.3f %10d %10ld %10d\n", governed ? "governed" : "fixed", total / steps * 1e3,
+               worst * 1e3, over, updates, reduced);
+        mipFree(&m);
+        worldFree(w);
+    }
+    free(pixels);
+}
+
+// updates per second one at a time against several per pass over the world, on a
+// world falling into its bottom half, at sizes past what fits in cache
+static bool benchBlocked(long cache) {
+    static const int SIZES[] = { 1024, 2048, 4096 };
+    if (!cache) cache = cacheSize();
+    printf("temporal blocking, %ld KB cache, %d steps\n", cache >> 10, steps);
+    printf("  %-12s %10s %10s %8s %8s %10s\n", "world", "steps/s", "blocked", "per pass", "rows", "speedup");
+    bool match = true;
+    for (int s = 0; s < 3; s++) {
+        int n = size ? size : SIZES[s];
+        world_t plain, blocked;
+        worldInit(&plain, n, n, seed);
+        worldInit(&blocked, n, n, seed);
+        fillNoise(&plain, 0.3f);
+        fillNoise(&blocked, 0.3f);
+
+        double start = now();
+        for (int i = 0; i < steps; i++) {
+            UpdateGrid(&plain);
+        }
+        double plainTime = now() - start;
+        start = now();
+        UpdateGridBlocked(&blocked, steps, cache);
+        double blockedTime = now() - start;
+
+        int k, rows;
+        blockShape(&blocked, cache, &k, &rows);
+        char name[32];
+        snprintf(name, sizeof(name), "%dx%d", n, n);
+        printf("  %-12s %10.1f %10.1f %8d %8d %9.2fx\n", name, steps / plainTime, steps / blockedTime, k, rows,
+               plainTime / blockedTime);
+        if (hashWorld(&plain) != hashWorld(&blocked)) {
+            printf("  %s MISMATCH\n", name);
+            match = false;
+        }
+        worldFree(&plain);
+        worldFree(&blocked);
+        if (size) break;
+    }
+    return match;
+}
+
+// a world update against a heat field diffusion step at the same world size, with the
+// field at one value per 4x4 block stepped every 4 updates
+static void benchHeat() {
+    static const int SIZES[] = { 512, 1024, 2048 };
+    printf("heat field, 4x4 blocks, %d steps\n", steps);
+    printf("  %-12s %12s %12s %12s %10s\n", "world", "update ms", "diffuse ms", "apply ms", "per update");
+    for (int s = 0; s < 3; s++) {
+        int n = size ? size : SIZES[s];
+        world_t world;
+        world_t* w = &world;
+        worldInit(w, n, n, seed);
+        fillNoise(w, 0.3f);
+        heat_t h;
+        heatInit(&h, w, 2);
+        for (int i = 0; i < 64; i++) heatAdd(&h, rand() % n, rand() % n, 50);
+
+        double start = now();
+        for (int i = 0; i < steps; i++) {
+            UpdateGrid(w);
+        }
+        double update = (now() - start) / steps;
+        start = now();
+        for (int i = 0; i < steps; i++) {
+            heatDiffuse(&h);
+        }
+        double diffuse = (now() - start) / steps;
+        start = now();
+        for (int i = 0; i < steps; i++) {
+            heatApply(&h, w);
+        }
+        double apply = (now() - start) / steps;
+
+        char name[32];
+        snprintf(name, sizeof(name), "%dx%d", n, n);
+        printf("  %-12s %12.3f %12.3f %12.3f %9.1f%%\n", name, update * 1e3, diffuse * 1e3, apply * 1e3,
+               (diffuse + apply) / h.every / update * 100);
+        heatFree(&h);
+        worldFree(w);
+        if (size) break;
+    }
+}
+
+// the block rule against the classic one, on the same scene from the same start
+static void benchMargolus() {
+    static const int SIZES[] = { 256, 512, 1024, 2048 };
+    printf("block rule against classic, %d steps\n", steps);
+    printf("  %-12s %12s %12s %12s %12s\n", "world", "classic ms", "moved", "block ms", "moved");
+    for (int s = 0; s < 4; s++) {
+        int n = size ? size : SIZES[s];
+        double ms[2];
+        long long moved[2];
+        for (int rule = 0; rule < 2; rule++) {
+            world_t w;
+            worldInit(&w, n, n, seed);
+            fillNoise(&w, 0.3f);
+            moved[rule] = 0;
+            double start = now();
+            for (int i = 0; i < steps; i++) {
+                moved[rule] += rule ? UpdateGridMargolus(&w) : UpdateGrid(&w);
+            }
+            ms[rule] = (now() - start) / steps * 1e3;
+            worldFree(&w);
+        }
+
+        char name[32];
+        snprintf(name, sizeof(name), "%dx%d", n, n);
+        printf("  %-12s %12.3f %12lld %12.3f %12lld\n", name, ms[0], moved[0] / steps, ms[1], moved[1] / steps);
+        if (size) break;
+    }
+}
+
+// rectangle counts from the chunk tree against scanning the cells they cover
+static bool benchRegions() {
+    static const int SIZES[] = { 512, 1024, 2048 };
+    const int queries = 256;
+    bool match = true;
+    printf("random rectangle counts, %d queries\n", queries);
+    printf("  %-12s %12s %12s %10s\n", "world", "scan us", "index us", "speedup");
+    for (int s = 0; s < 3; s++) {
+        int n = size ? size : SIZES[s];
+        world_t w;
+        worldInit(&w, n, n, seed);
+        fillNoise(&w, 0.3f);
+        for (int i = 0; i < 20; i++) UpdateGrid(&w);
+
+        int* rects = malloc(queries * 4 * sizeof(int));
+        srand(seed);
+        for (int q = 0; q < queries; q++) {
+            int* r = rects + q * 4;
+            r[0] = rand() % n;
+            r[1] = rand() % n;
+            r[2] = r[0] + rand() % (n - r[0] + 1);
+            r[3] = r[1] + rand() % (n - r[1] + 1);
+        }
+        long long scanned = 0, indexed = 0;
+        double start = now();
+        for (int q = 0; q < queries; q++) {
+            const int* r = rects + q * 4;
+            for (int i = r[0]; i < r[2]; i++) {
+                for (int j = r[1]; j < r[3]; j++) scanned += w.cells[cellIndex(&w, i, j)].e;
+            }
+        }
+        double scan = (now() - start) / queries;
+        start = now();
+        for (int q = 0; q < queries; q++) {
+            const int* r = rects + q * 4;
+            indexed += countRect(&w, r[0], r[1], r[2], r[3]);
+        }
+        double index = (now() - start) / queries;
+        match = match && scanned == indexed;
+
+        char name[32];
+        snprintf(name, sizeof(name), "%dx%d", n, n);
+        printf("  %-12s %12.2f %12.2f %9.0fx%s\n", name, scan * 1e6, index * 1e6, scan / index,
+               scanned == indexed ? "" : "  MISMATCH");
+        free(rects);
+        worldFree(&w);
+        if (size) break;
+    }
+    return match;
+}
+
+typedef struct share_reader {
+    int done;
+    int snapshots;
+    int failed;
+} share_reader_t;
+
+// snapshots of the shared world back to back until told to stop
+static void* shareReadLoop(void* arg) {
+    share_reader_t* rd = arg;
+    share_t r;
+    if (!shareAttach(&r, "sandsim_bench")) return NULL;
+    particle_t* cells = malloc((size_t) r.header->stride * (r.header->height + 2) * sizeof(particle_t));
+    while (!atomicLoad(&rd->done)) {
+        if (shareSnapshot(&r, cells, NULL, 1)) {
+            atomicAdd(&rd->snapshots, 1);
+        } else {
+            atomicAdd(&rd->failed, 1);
+        }
+    }
+    free(cells);
+    shareDetach(&r);
+    return NULL;
+}
+
+// update time of a world published in shared memory while 0 to readers other threads
+// copy snapshots of it as fast as they can
+static bool benchShare(int readers) {
+    int n = size ? size : 1024;
+    printf("%dx%d world in shared memory, %d steps, %d cpus\n", n, n, steps, cpuCount());
+    printf("  %-10s %10s %10s %12s %12s\n", "readers", "ms/update", "slowdown", "snapshots/s", "retried");
+    double alone = 0;
+    for (int count = -1; count <= readers; count++) {
+        world_t w;
+        worldInit(&w, n, n, seed);
+        fillNoise(&w, 0.3f);
+        // -1 is the world kept private, for what bracketing the updates costs
+        share_t s;
+        if (count >= 0 && !shareOpen(&s, &w, "sandsim_bench")) {
+            fprintf(stderr, "can't create a shared memory segment\n");
+            worldFree(&w);
+            return false;
+        }
+        share_reader_t* rd = calloc(readers + 1, sizeof(share_reader_t));
+        thread_t* t = malloc((readers + 1) * sizeof(thread_t));
+        for (int k = 0; k < count; k++) threadStart(&t[k], shareReadLoop, &rd[k]);
+
+        double start = now();
+        for (int i = 0; i < steps; i++) {
+            if (count >= 0) shareBegin(&s);
+            UpdateGrid(&w);
+            if (count >= 0) shareEnd(&s);
+        }
+        double update = (now() - start) / steps;
+        int snapshots = 0, failed = 0;
+        for (int k = 0; k < count; k++) {
+            atomicStore(&rd[k].done, 1);
+            threadJoin(&t[k]);
+            snapshots += rd[k].snapshots;
+            failed += rd[k].failed;
+        }
+        if (count == -1) alone = update;
+
+        char name[16];
+        snprintf(name, sizeof(name), count < 0 ? "private" : "%d", count);
+        printf("  %-10s %10.3f %9.2fx %12.0f %12d\n", name, update * 1e3, update / alone,
+               snapshots / (update * steps), failed);
+        free(rd);
+        free(t);
+        if (count >= 0) shareClose(&s);
+        worldFree(&w);
+    }
+    return true;
+}
+
+// bulk edits against set() on every cell they cover, on a half full world
+static void benchEdits() {
+    int n = size ? size : 4096;
+    world_t w;
+    worldInit(&w, n, n, seed);
+    w.worklist = true;
+    printf("bulk edits on %dx%d\n", n, n);
+    printf("  %-16s %10s %12s %12s\n", "edit", "cells", "bulk ms", "set() ms");
+    particle_t paint = { RGB(200, 100, 50), true, false, 0 };
+    // a five pointed star over most of the world
+    vertex_t star[5];
+    for (int k = 0; k < 5; k++) {
+        double angle = k * 4 * 3.14159265358979 / 5;
+        star[k] = (vertex_t) { n / 2 - n * 0.45 * cos(angle), n / 2 + n * 0.45 * sin(angle) };
+    }
+    for (int e = 0; e < 7; e++) {
+        double ms[2];
+        int cells = 0;
+        for (int bulk = 1; bulk >= 0; bulk--) {
+            fillNoise(&w, 0.5f);
+            setRect(&w, n / 2, 0, n, n, EMPTY);
+            // a wall down the middle of the empty half, for the flood fills to stop at
+            setRect(&w, n / 2, n / 2, n, n / 2 + 1, paint);
+            double start = now();
+            int r = n / 3;
+            switch (e) {
+                case 0:
+                case 1:
+                    if (bulk) {
+                        cells = setRect(&w, 0, 0, n, n, e ? EMPTY : paint);
+                    } else {
+                        for (int i = 0; i < n; i++) {
+                            for (int j = 0; j < n; j++) set(&w, i, j, e ? EMPTY : paint);
+                        }
+                    }
+                    break;
+                case 2:
+                case 3:
+                    if (bulk) {
+                        cells = fillCircle(&w, n / 2, n / 2, r, e == 3 ? EMPTY : paint);
+                    } else {
+                        for (int i = -r + 1; i < r; i++) {
+                            for (int j = -r + 1; j < r; j++) {
+                                if (i * i + j * j < r * r) set(&w, n / 2 + i, n / 2 + j, e == 3 ? EMPTY : paint);
+                            }
+                        }
+                    }
+                    break;
+                case 4:
+                    if (bulk) cells = fillPolygon(&w, star, 5, paint);
+                    break;
+                case 5:
+                    if (bulk) cells = floodFill(&w, n - 1, 0, paint);
+                    break;
+                case 6:
+                    setRect(&w, 0, 0, n / 2, n, paint);
+                    start = now();
+                    if (bulk) cells = floodFill(&w, 0, 0, EMPTY);
+                    break;
+            }
+            ms[bulk] = (now() - start) * 1e3;
+        }
+        static const char* NAMES[] = { "fill world", "erase world", "fill circle", "erase circle", "fill star",
+                                       "flood fill cave", "flood erase pile" };
+        if (e < 4) {
+            printf("  %-16s %10d %12.3f %12.3f\n", NAMES[e], cells, ms[1], ms[0]);
+        } else {
+            printf("  %-16s %10d %12.3f %12s\n", NAMES[e], cells, ms[1], "-");
+        }
+    }
+    worldFree(&w);
+}
+
+// every standard scene stepped and rendered a frame at a time with the counters kept,
+// without the overlay and then with it drawn over each frame. the step and render
+// columns have to come out the same either way
+static void benchStats() {
+    enum { FRAME = 1000 };
+    int n = size ? size : 1024;
+    uint32_t* pixels = malloc(FRAME * FRAME * sizeof(uint32_t));
+    printf("frame counters, %dx%d into %dx%d, %d frames\n", n, n, FRAME, FRAME, steps);
+    for (int t = 0; t < SCENE_TYPE_COUNT; t++) {
+        const scene_type_t* scene = &SCENE_TYPES[t];
+        for (int hud = 0; hud < 2; hud++) {
+            world_t w;
+            sceneCreate(&w, scene, n, n, seed);
+            camera_t camera = cameraFit(n, n, FRAME, FRAME);
+            mip_t m;
+            mipInit(&m, &w);
+            stats_t s;
+            statsInit(&s, &w);
+            double overlay = 0;
+            double last = now();
+            for (int f = 0; f < steps; f++) {
+                double start = now();
+                sceneStep(&w, scene);
+                double stepped = now();
+                mipUpdateView(&m, &w, camera, FRAME, FRAME);
+                mipRender(&m, &w, camera, pixels, FRAME, FRAME, RGB(0, 0, 0));
+                double rendered = now();
+                statsFrame(&s, &w, 1, stepped - start, 0, rendered - stepped, rendered - last);
+                if (hud) {
+                    statsDraw(&s, pixels, FRAME, FRAME, 8, 8);
+                    overlay += now() - rendered;
+                }
+                last = rendered;
+            }
+            printf("  %-10s %-8s ", scene->name, hud ? "overlay" : "counters");
+            statsPrint(&s, stdout);
+            if (hud) printf("  %-10s %-8s %.3f ms per frame to draw\n", "", "", overlay / steps * 1e3);
+            mipFree(&m);
+            worldFree(&w);
+        }
+    }
+    free(pixels);
+}
+
+// a steady load from emitters and sinks, from a scene file or a pour into a drain.
+// the first half of the updates fill the world up, the second half are timed
+static bool benchFlow(const char* path) {
+    printf("emitters and sinks, %d updates to fill and %d timed\n", steps, steps);
+    printf("  %-12s %12s %12s %12s %12s\n", "stepping", "ms", "grains", "in/update", "out/update");
+    for (int list = 0; list < 2; list++) {
+        world_t w;
+        flow_t f;
+        if (path) {
+            if (!flowLoad(&w, &f, path)) return false;
+        } else {
+            int n = size ? size : 512;
+            worldInit(&w, n, n, seed);
+            flowInit(&f);
+            flowAddEmitter(&f, (shape_t) { SHAPE_DISC, n / 16, n / 2, 0, 0, n / 32 + 1 }, n / 8.0f);
+            flowAddSink(&f, (shape_t) { SHAPE_RECT, n - 2, 0, 2, n, 0 }, 0);
+        }
+        w.worklist = list;
+        for (int s = 0; s < steps; s++) {
+            flowStep(&f, &w);
+        }
+        long long emitted = f.emitted, removed = f.removed;
+        double start = now();
+        for (int s = 0; s < steps; s++) {
+            flowStep(&f, &w);
+        }
+        double ms = (now() - start) / steps * 1e3;
+        printf("  %-12s %12.3f %12d %12.1f %12.1f\n", list ? "worklist" : "full scan", ms, countGrains(&w),
+               (double) (f.emitted - emitted) / steps, (double) (f.removed - removed) / steps);
+        flowFree(&f);
+        worldFree(&w);
+    }
+    return true;
+}
+
+// the same scene on one process and split over ranks processes, which must agree
+static bool benchRanks(int ranks) {
+    int side = size ? size : 512;
+    domain_result_t single, split;
+    domainReference(side, side, seed, steps, &single);
+    if (!domainRun(ranks, side, side, seed, steps, &split)) return false;
+
+    printf("domain decomposition, %dx%d, %d steps, %d bands\n", side, side, steps, ranks);
+    printf("  %-24s %10.3f ms %8d grains %016llx\n", "1 process", single.seconds * 1e3, single.grains,
+           (unsigned long long) single.hash);
+    printf("  %-24s %10.3f ms %8d grains %016llx\n", "banded", split.seconds * 1e3, split.grains,
+           (unsigned long long) split.hash);
+    bool match = single.hash == split.hash && single.grains == split.grains;
+    printf("  %s\n", match ? "match" : "MISMATCH");
+    return match;
+}
+
+static void usage() {
+    fprintf(stderr, "usage: sandsim_bench [--size N] [--steps N] [--seed N] [--threads N] [--placement on|off]\n"
+                    "                     [--batch WORLDS | --kernels | --serve PORT [--bind ADDRESS]\n"
+                    "                      | --ranks N | --checkpoint EVERY | --render | --airborne | --suite\n"
+                    "                      | --governor FRAME_MS | --blocked [--cache BYTES] | --heat\n"
+                    "                      | --regions | --share READERS | --margolus\n"
+                    "                      | --worklist | --flow [FILE] | --history MEGABYTES [--key-every N]\n"
+                    "                      | --edits | --stats]\n");
+    exit(1);
+}
+
+int main(int argc, char** argv) {
+    int batch = 0;
+    bool kernels = false;
+    int port = 0;
+    // spectators are served on loopback unless another address is asked for
+    const char* address = NULL;
+    int ranks = 0;
+    int every = 0;
+    bool render = false;
+    bool airborne = false;
+    bool suite = false;
+    double budget = 0;
+    // worker placement for --batch: 1 on, 0 off, -1 both
+    int policy = -1;
+    bool blocked = false;
+    bool heat = false;
+    bool regions = false;
+    bool margolus = false;
+    bool worklist = false;
+    bool flow = false;
+    bool edits = false;
+    bool stats = false;
+    const char* flowPath = NULL;
+    int readers = -1;
+    int history = 0;
+    long cache = 0;
+    // frames between keyframes for --history
+    int keyEvery = 64;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--size") == 0) {
+            size = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--steps") == 0) {
+            steps = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--seed") == 0) {
+            seed = strtoul(argv[++i], NULL, 10);
+        } else if (i + 1 < argc && strcmp(argv[i], "--threads") == 0) {
+            threads = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--batch") == 0) {
+            batch = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--placement") == 0) {
+            i++;
+            policy = strcmp(argv[i], "on") == 0 ? 1 : strcmp(argv[i], "off") == 0 ? 0 : -2;
+        } else if (i + 1 < argc && strcmp(argv[i], "--serve") == 0) {
+            port = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--bind") == 0) {
+            address = argv[++i];
+        } else if (i + 1 < argc && strcmp(argv[i], "--ranks") == 0) {
+            ranks = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--checkpoint") == 0) {
+            every = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--governor") == 0) {
+            budget = atof(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--share") == 0) {
+            readers = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--history") == 0) {
+            history = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--key-every") == 0) {
+            keyEvery = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--cache") == 0) {
+            cache = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--heat") == 0) {
+            heat = true;
+        } else if (strcmp(argv[i], "--regions") == 0) {
+            regions = true;
+        } else if (strcmp(argv[i], "--margolus") == 0) {
+            margolus = true;
+        } else if (strcmp(argv[i], "--worklist") == 0) {
+            worklist = true;
+        } else if (strcmp(argv[i], "--edits") == 0) {
+            edits = true;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            stats = true;
+        } else if (strcmp(argv[i], "--flow") == 0) {
+            flow = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-') flowPath = argv[++i];
+        } else if (strcmp(argv[i], "--blocked") == 0) {
+            blocked = true;
+        } else if (strcmp(argv[i], "--kernels") == 0) {
+            kernels = true;
+        } else if (strcmp(argv[i], "--render") == 0) {
+            render = true;
+        } else if (strcmp(argv[i], "--airborne") == 0) {
+            airborne = true;
+        } else if (strcmp(argv[i], "--suite") == 0) {
+            suite = true;
+        } else {
+            usage();
+        }
+    }
+    if (size < 0 || steps <= 0 || batch < 0 || ranks < 0 || every < 0 || budget < 0 || policy < -1 || cache < 0 || history < 0 || keyEvery <= 0) usage();
+
+    if (batch) {
+        benchBatch(batch, policy);
+    } else if (every) {
+        return benchCheckpoint(every) ? 0 : 1;
+    } else if (ranks) {
+        return benchRanks(ranks) ? 0 : 1;
+    } else if (port) {
+        serve(address, port);
+    } else if (kernels) {
+        benchKernels();
+    } else if (render) {
+        benchRender();
+    } else if (airborne) {
+        return benchAirborne() ? 0 : 1;
+    } else if (suite) {
+        benchSuite();
+    } else if (budget) {
+        benchGovernor(budget);
+    } else if (heat) {
+        benchHeat();
+    } else if (regions) {
+        return benchRegions() ? 0 : 1;
+    } else if (margolus) {
+        benchMargolus();
+    } else if (worklist) {
+        return benchWorklist() ? 0 : 1;
+    } else if (history) {
+        return benchHistory(history, keyEvery) ? 0 : 1;
+    } else if (edits) {
+        benchEdits();
+    } else if (stats) {
+        benchStats();
+    } else if (flow) {
+        return benchFlow(flowPath) ? 0 : 1;
+    } else if (readers >= 0) {
+        return benchShare(readers) ? 0 : 1;
+    } else if (blocked) {
+        return benchBlocked(cache) ? 0 : 1;
+    } else {
+        benchSurface();
+    }
+    return 0;
+}
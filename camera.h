@@ -0,0 +1,71 @@
+#ifndef SANDSIM_CAMERA_H
+#define SANDSIM_CAMERA_H
+
+#include <stdbool.h>
+
+// what part of the world is on screen: the world position of the top left
+// corner of the top left pixel, and cells per pixel
+typedef struct camera {
+    double x;
+    double y;
+    double scale;
+} camera_t;
+
+// closest in and furthest out a camera zooms, in cells per pixel
+#define CAMERA_MIN_SCALE (1.0 / 64)
+#define CAMERA_MAX_SCALE 1024.0
+
+// world position under screen position (sx, sy)
+static inline void cameraToWorld(const camera_t* c, double sx, double sy, double* wx, double* wy) {
+    *wx = c->x + sx * c->scale;
+    *wy = c->y + sy * c->scale;
+}
+
+// screen position of world position (wx, wy)
+static inline void cameraToScreen(const camera_t* c, double wx, double wy, double* sx, double* sy) {
+    *sx = (wx - c->x) / c->scale;
+    *sy = (wy - c->y) / c->scale;
+}
+
+// move the view by (dx, dy) screen pixels
+static inline void cameraPan(camera_t* c, double dx, double dy) {
+    c->x += dx * c->scale;
+    c->y += dy * c->scale;
+}
+
+// zoom in by factor (out for factor < 1), keeping the world under screen position (sx, sy) in place
+static inline void cameraZoom(camera_t* c, double factor, double sx, double sy) {
+    double wx, wy;
+    cameraToWorld(c, sx, sy, &wx, &wy);
+    double scale = c->scale / factor;
+    c->scale = scale < CAMERA_MIN_SCALE ? CAMERA_MIN_SCALE : scale > CAMERA_MAX_SCALE ? CAMERA_MAX_SCALE : scale;
+    c->x = wx - sx * c->scale;
+    c->y = wy - sy * c->scale;
+}
+
+// the whole world, as large as fits in a screen of screenWidth x screenHeight and centered
+static inline camera_t cameraFit(int worldWidth, int worldHeight, int screenWidth, int screenHeight) {
+    camera_t c;
+    double sx = (double) worldWidth / (screenWidth > 0 ? screenWidth : 1);
+    double sy = (double) worldHeight / (screenHeight > 0 ? screenHeight : 1);
+    c.scale = sx > sy ? sx : sy;
+    c.x = (worldWidth - screenWidth * c.scale) / 2;
+    c.y = (worldHeight - screenHeight * c.scale) / 2;
+    return c;
+}
+
+// world cells [x0, x1) x [y0, y1) at least partly on a screenWidth x screenHeight screen,
+// clipped to a width x height world. false if none are
+static inline bool cameraVisible(const camera_t* c, int screenWidth, int screenHeight, int width, int height,
+                                 int* x0, int* y0, int* x1, int* y1) {
+    double left, top, right, bottom;
+    cameraToWorld(c, 0, 0, &left, &top);
+    cameraToWorld(c, screenWidth, screenHeight, &right, &bottom);
+    *x0 = left < 0 ? 0 : (int) left;
+    *y0 = top < 0 ? 0 : (int) top;
+    *x1 = right >= width ? width : (int) right + 1;
+    *y1 = bottom >= height ? height : (int) bottom + 1;
+    return *x0 < *x1 && *y0 < *y1;
+}
+
+#endif
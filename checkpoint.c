@@ -0,0 +1,190 @@
+#include "checkpoint.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "thread.h"
+
+// where each chunk is. the writer and the simulation race to move a chunk out of
+// PENDING, whoever wins decides which copy of it ends up in the file
+enum {
+    // unchanged since the checkpoint began, nobody has it
+    CHUNK_PENDING,
+    // the simulation is copying it aside
+    CHUNK_COPYING,
+    // the copy is ready for the writer
+    CHUNK_COPIED,
+    // the writer is copying it out of the live grid
+    CHUNK_CLAIMED,
+    // saved, the simulation may write it
+    CHUNK_DONE,
+};
+
+struct checkpoint {
+    const world_t* w;
+    FILE* file;
+    checkpoint_header_t header;
+    thread_t thread;
+    int chunks;
+    int* state;
+    // chunks the simulation copied aside, freed by the writer once saved
+    particle_t** copies;
+    int copied;
+    int finished;
+    bool ok;
+};
+
+typedef struct checkpoint checkpoint_t;
+
+// cells of chunk c, row by row. returns how many
+static int copyChunk(const world_t* w, int c, particle_t* out) {
+    int x0, y0, x1, y1;
+    chunkBounds(w->width, w->height, c, &x0, &y0, &x1, &y1);
+    int n = 0;
+    for (int i = y0; i < y1; i++) {
+        const particle_t* row = &w->cells[cellIndex(w, i, 0)];
+        for (int j = x0; j < x1; j++) {
+            out[n++] = row[j];
+        }
+    }
+    return n;
+}
+
+// the world's beforeWrite hook while a checkpoint is running
+static void preserveChunk(world_t* w, int c) {
+    checkpoint_t* cp = w->checkpoint;
+    if (atomicSwap(&cp->state[c], CHUNK_PENDING, CHUNK_COPYING)) {
+        cp->copies[c] = malloc(CHUNK_SIZE * CHUNK_SIZE * sizeof(particle_t));
+        copyChunk(w, c, cp->copies[c]);
+        cp->copied++;
+        atomicStore(&cp->state[c], CHUNK_COPIED);
+        return;
+    }
+    // the writer is in the middle of saving it, which takes no longer than our copy would
+    while (atomicLoad(&cp->state[c]) == CHUNK_CLAIMED) {
+        threadYield();
+    }
+}
+
+static void* writer(void* param) {
+    checkpoint_t* cp = param;
+    particle_t* scratch = malloc(CHUNK_SIZE * CHUNK_SIZE * sizeof(particle_t));
+    bool ok = fwrite(&cp->header, sizeof(cp->header), 1, cp->file) == 1;
+
+    for (int c = 0; c < cp->chunks; c++) {
+        const particle_t* cells;
+        int n;
+        if (atomicSwap(&cp->state[c], CHUNK_PENDING, CHUNK_CLAIMED)) {
+            n = copyChunk(cp->w, c, scratch);
+            atomicStore(&cp->state[c], CHUNK_DONE);
+            cells = scratch;
+        } else {
+            while (atomicLoad(&cp->state[c]) != CHUNK_COPIED) {
+                threadYield();
+            }
+            int x0, y0, x1, y1;
+            chunkBounds(cp->w->width, cp->w->height, c, &x0, &y0, &x1, &y1);
+            n = (y1 - y0) * (x1 - x0);
+            cells = cp->copies[c];
+        }
+        ok = ok && fwrite(cells, sizeof(particle_t), n, cp->file) == (size_t) n;
+        if (cells != scratch) {
+            free(cp->copies[c]);
+            cp->copies[c] = NULL;
+        }
+    }
+
+    ok = fclose(cp->file) == 0 && ok;
+    cp->ok = ok;
+    free(scratch);
+    atomicStore(&cp->finished, 1);
+    return NULL;
+}
+
+bool checkpointBegin(world_t* w, const char* path) {
+    if (w->checkpoint) return false;
+    FILE* file = fopen(path, "wb");
+    if (!file) return false;
+
+    checkpoint_t* cp = calloc(1, sizeof(checkpoint_t));
+    cp->w = w;
+    cp->file = file;
+    cp->header = (checkpoint_header_t) {
+        CHECKPOINT_MAGIC, CHECKPOINT_VERSION, w->width, w->height, w->seed, w->step,
+        w->originY, w->colorDirection, w->currentColor, w->colorRate, w->colorPercent
+    };
+    cp->chunks = w->chunksX * w->chunksY;
+    cp->state = calloc(cp->chunks, sizeof(int));
+    cp->copies = calloc(cp->chunks, sizeof(particle_t*));
+
+    w->checkpoint = cp;
+    w->beforeWrite = preserveChunk;
+    // every chunk's next write is now its first of an epoch and goes through preserveChunk()
+    nextEpoch(w);
+
+    if (!threadStart(&cp->thread, writer, cp)) {
+        w->checkpoint = NULL;
+        w->beforeWrite = NULL;
+        fclose(file);
+        free(cp->state);
+        free(cp->copies);
+        free(cp);
+        return false;
+    }
+    return true;
+}
+
+bool checkpointBusy(const world_t* w) {
+    return w->checkpoint && !atomicLoad(&w->checkpoint->finished);
+}
+
+int checkpointEnd(world_t* w) {
+    checkpoint_t* cp = w->checkpoint;
+    if (!cp) return -1;
+    threadJoin(&cp->thread);
+    w->checkpoint = NULL;
+    w->beforeWrite = NULL;
+
+    int result = cp->ok ? cp->copied : -1;
+    free(cp->state);
+    free(cp->copies);
+    free(cp);
+    return result;
+}
+
+bool checkpointLoad(world_t* w, const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return false;
+    checkpoint_header_t h;
+    if (fread(&h, sizeof(h), 1, file) != 1 || h.magic != CHECKPOINT_MAGIC || h.version != CHECKPOINT_VERSION ||
+        h.width == 0 || h.height == 0) {
+        fclose(file);
+        return false;
+    }
+
+    worldInit(w, h.width, h.height, h.seed);
+    w->step = h.step;
+    w->originY = h.originY;
+    w->colorDirection = h.colorDirection;
+    w->currentColor = h.currentColor;
+    w->colorRate = h.colorRate;
+    w->colorPercent = h.colorPercent;
+
+    particle_t* chunk = malloc(CHUNK_SIZE * CHUNK_SIZE * sizeof(particle_t));
+    bool ok = true;
+    for (int c = 0; c < w->chunksX * w->chunksY && ok; c++) {
+        int x0, y0, x1, y1;
+        chunkBounds(w->width, w->height, c, &x0, &y0, &x1, &y1);
+        size_t n = (size_t) (y1 - y0) * (x1 - x0);
+        ok = fread(chunk, sizeof(particle_t), n, file) == n;
+        for (int i = y0, k = 0; ok && i < y1; i++) {
+            for (int j = x0; j < x1; j++, k++) {
+                set(w, i, j, chunk[k]);
+            }
+        }
+    }
+    free(chunk);
+    fclose(file);
+    if (!ok) worldFree(w);
+    return ok;
+}
@@ -0,0 +1,44 @@
+#ifndef SANDSIM_CHECKPOINT_H
+#define SANDSIM_CHECKPOINT_H
+
+#include <stdbool.h>
+
+#include "sim.h"
+
+// checkpoints are written by a background thread while the world keeps updating.
+// at checkpointBegin() every chunk is marked copy-on-write: the writer saves chunks
+// in order straight from the live grid, and a chunk the simulation is about to write
+// before the writer got to it is copied aside first, so the file holds the world
+// exactly as it was when the checkpoint began.
+//
+// the file is a checkpoint_header_t followed by every chunk in index order, each
+// chunk's cells row by row as particle_t, all in the machine's byte order
+#define CHECKPOINT_MAGIC 0x4B444E53u
+#define CHECKPOINT_VERSION 1
+
+typedef struct checkpoint_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t seed;
+    uint32_t step;
+    int32_t originY;
+    int32_t colorDirection;
+    uint32_t currentColor;
+    float colorRate;
+    double colorPercent;
+} checkpoint_header_t;
+
+// start saving w to path. false if the file can't be created or a checkpoint is already running
+bool checkpointBegin(world_t* w, const char* path);
+// true while the background writer is still going
+bool checkpointBusy(const world_t* w);
+// wait for the writer and detach the checkpoint from w. must be called before w is freed.
+// returns the number of chunks the simulation had to copy, -1 if the file couldn't be written
+int checkpointEnd(world_t* w);
+
+// read a checkpoint into w, which must not be initialized yet
+bool checkpointLoad(world_t* w, const char* path);
+
+#endif
@@ -0,0 +1,257 @@
+#include "domain.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "net.h"
+#include "sim.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+static double now() {
+#ifdef _WIN32
+    LARGE_INTEGER count, frequency;
+    QueryPerformanceCounter(&count);
+    QueryPerformanceFrequency(&frequency);
+    return (double) count.QuadPart / frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+}
+
+// the scene: noise over the top half of the whole world, picked per cell from the
+// seed so every band can fill its own rows, plus a pour at the top for half the run
+static void fillRows(world_t* w, uint32_t seed, int totalHeight, int rows) {
+    for (int i = 0; i < rows; i++) {
+        int y = i + w->originY;
+        if (y >= totalHeight / 2) break;
+        for (int j = 0; j < w->width; j++) {
+            uint32_t h = (seed ^ (uint32_t) y * 0x85EBCA77u) + (uint32_t) j * 0xC2B2AE3Du;
+            h ^= h >> 13;
+            h *= 0x2C1B3C6Du;
+            h ^= h >> 16;
+            if (h % 100 < 30) set(w, i, j, (particle_t) { RGB(j, y, y ^ j), true, false, 0 });
+        }
+    }
+}
+
+static void feed(world_t* w, int step, int steps) {
+    if (w->originY == 0 && step < steps / 2) pour(w, 8);
+}
+
+static void summarize(const world_t* w, double seconds, domain_result_t* out) {
+    out->grains = countGrains(w);
+    out->hash = hashWorld(w);
+    out->seconds = seconds;
+}
+
+void domainReference(int width, int height, uint32_t seed, int steps, domain_result_t* out) {
+    world_t w;
+    worldInit(&w, width, height, seed);
+    fillRows(&w, seed, height, height);
+    double start = now();
+    for (int s = 0; s < steps; s++) {
+        feed(&w, s, steps);
+        UpdateGrid(&w);
+    }
+    summarize(&w, now() - start, out);
+    worldFree(&w);
+}
+
+#ifdef _WIN32
+bool domainRun(int ranks, int width, int height, uint32_t seed, int steps, domain_result_t* out) {
+    (void) ranks;
+    (void) width;
+    (void) height;
+    (void) seed;
+    (void) steps;
+    (void) out;
+    fprintf(stderr, "domain decomposition needs fork(), not available on windows\n");
+    return false;
+}
+#else
+static void sendRows(net_socket_t s, const world_t* w, int y0, int rows) {
+    for (int i = y0; i < y0 + rows; i++) {
+        if (!netSend(s, &w->cells[cellIndex(w, i, 0)], w->width * sizeof(particle_t))) _exit(2);
+    }
+}
+
+static void receiveRows(net_socket_t s, world_t* w, int y0, int rows, particle_t* scratch) {
+    for (int i = y0; i < y0 + rows; i++) {
+        if (!netRecv(s, scratch, w->width * sizeof(particle_t))) _exit(2);
+        // most of a halo is unchanged between updates, only pay set() for what moved
+        particle_t* row = &w->cells[cellIndex(w, i, 0)];
+        for (int j = 0; j < w->width; j++) {
+            if (memcmp(&row[j], &scratch[j], sizeof(particle_t)) != 0) set(w, i, j, scratch[j]);
+        }
+    }
+}
+
+// the life of one band process. above/below are the neighbour links, NET_INVALID at the ends
+static void runBand(int y0, int rows, int halo, int width, int totalHeight, uint32_t seed, int steps,
+                    net_socket_t above, net_socket_t below, net_socket_t parent) {
+    world_t w;
+    worldInit(&w, width, rows + halo, seed);
+    w.originY = y0;
+    fillRows(&w, seed, totalHeight, rows + halo);
+    particle_t* scratch = malloc(width * sizeof(particle_t));
+    // rows a band shares with the one above: the above band's halo
+    int shared = above != NET_INVALID ? MAX_FALL : 0;
+
+    for (int s = 0; s < steps; s++) {
+        // our top rows as the band above left them after landing its grains last update
+        if (above != NET_INVALID && s > 0) receiveRows(above, &w, 0, shared, scratch);
+        // the band below after this update
+        if (below != NET_INVALID) receiveRows(below, &w, rows, halo, scratch);
+
+        feed(&w, s, steps);
+        UpdateBand(&w, rows);
+
+        if (below != NET_INVALID) sendRows(below, &w, rows, halo);
+        if (above != NET_INVALID) sendRows(above, &w, 0, shared);
+    }
+    // the final grains the band above landed in us
+    if (above != NET_INVALID) receiveRows(above, &w, 0, shared, scratch);
+
+    sendRows(parent, &w, 0, rows);
+    free(scratch);
+    worldFree(&w);
+}
+
+static void closeEnd(int* fd) {
+    if (*fd >= 0) close(*fd);
+    *fd = -1;
+}
+
+// the socket pairs of bands [0, count) as domainRun() opens them, and the arrays holding
+// them. ends already closed are -1
+static void closeLinks(int (*links)[2], int (*results)[2], int count) {
+    for (int r = 0; r < count; r++) {
+        if (r > 0) {
+            closeEnd(&links[r][0]);
+            closeEnd(&links[r][1]);
+        }
+        closeEnd(&results[r][0]);
+        closeEnd(&results[r][1]);
+    }
+    free(links);
+    free(results);
+}
+
+// in band r's process, every end but the ones it talks through. a band that fails
+// then closes the last copy of its ends, and its neighbours and the parent see it
+static void keepBandEnds(int (*links)[2], int (*results)[2], int ranks, int r) {
+    for (int k = 0; k < ranks; k++) {
+        if (k > 0 && k != r) closeEnd(&links[k][1]);
+        if (k > 0 && k != r + 1) closeEnd(&links[k][0]);
+        if (k != r) closeEnd(&results[k][1]);
+        closeEnd(&results[k][0]);
+    }
+}
+
+bool domainRun(int ranks, int width, int height, uint32_t seed, int steps, domain_result_t* out) {
+    // every band has to be at least a halo tall, so grains never skip over one
+    if (ranks < 1 || height / ranks < MAX_FALL) {
+        fprintf(stderr, "%d bands of a %d row world are shorter than the %d row halo\n", ranks, height, MAX_FALL);
+        return false;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    // links[r] joins band r - 1 to band r, results[r] joins band r to us
+    int (*links)[2] = malloc((ranks + 1) * sizeof(*links));
+    int (*results)[2] = malloc(ranks * sizeof(*results));
+    for (int r = 0; r < ranks; r++) {
+        if (r > 0 && socketpair(AF_UNIX, SOCK_STREAM, 0, links[r]) != 0) {
+            perror("socketpair");
+            closeLinks(links, results, r);
+            return false;
+        }
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, results[r]) != 0) {
+            perror("socketpair");
+            if (r > 0) {
+                close(links[r][0]);
+                close(links[r][1]);
+            }
+            closeLinks(links, results, r);
+            return false;
+        }
+    }
+
+    double start = now();
+    pid_t* children = malloc(ranks * sizeof(pid_t));
+    for (int r = 0; r < ranks; r++) {
+        int y0 = height * r / ranks;
+        int y1 = height * (r + 1) / ranks;
+        int halo = r + 1 < ranks ? MAX_FALL : 0;
+        children[r] = fork();
+        if (children[r] < 0) {
+            perror("fork");
+            // the bands already started would wait on this one forever
+            for (int k = 0; k < r; k++) {
+                kill(children[k], SIGKILL);
+                waitpid(children[k], NULL, 0);
+            }
+            closeLinks(links, results, ranks);
+            free(children);
+            return false;
+        }
+        if (children[r] == 0) {
+            keepBandEnds(links, results, ranks, r);
+            net_socket_t above = r > 0 ? links[r][1] : NET_INVALID;
+            net_socket_t below = r + 1 < ranks ? links[r + 1][0] : NET_INVALID;
+            runBand(y0, y1 - y0, halo, width, height, seed, steps, above, below, results[r][1]);
+            _exit(0);
+        }
+    }
+
+    // only the bands hold the links and their ends of the results, so a band that dies
+    // ends its stream to us instead of leaving it open
+    for (int r = 0; r < ranks; r++) {
+        if (r > 0) {
+            closeEnd(&links[r][0]);
+            closeEnd(&links[r][1]);
+        }
+        closeEnd(&results[r][1]);
+    }
+
+    world_t w;
+    worldInit(&w, width, height, seed);
+    particle_t* scratch = malloc(width * sizeof(particle_t));
+    bool ok = true;
+    for (int r = 0; r < ranks; r++) {
+        int y0 = height * r / ranks;
+        int y1 = height * (r + 1) / ranks;
+        for (int i = y0; i < y1 && ok; i++) {
+            ok = netRecv(results[r][0], scratch, width * sizeof(particle_t));
+            for (int j = 0; ok && j < width; j++) {
+                set(&w, i, j, scratch[j]);
+            }
+        }
+    }
+    double elapsed = now() - start;
+
+    for (int r = 0; r < ranks; r++) {
+        int status;
+        waitpid(children[r], &status, 0);
+        ok = ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+    closeLinks(links, results, ranks);
+    summarize(&w, elapsed, out);
+
+    worldFree(&w);
+    free(scratch);
+    free(children);
+    return ok;
+}
+#endif
@@ -0,0 +1,26 @@
+#ifndef SANDSIM_DOMAIN_H
+#define SANDSIM_DOMAIN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// one world split into horizontal bands, each stepped by its own process.
+// a band's grains can fall up to MAX_FALL rows, so every process also keeps a
+// halo of that many rows of the band below, swapped with its neighbours each
+// update. bands are updated bottom first within an update, like rows are, so
+// the processes run as a pipeline: a band can start update t as soon as the
+// band below finished update t and the band above finished update t - 1
+
+typedef struct domain_result {
+    int grains;
+    uint64_t hash;
+    double seconds;
+} domain_result_t;
+
+// runs the benchmark scene in a single process
+void domainReference(int width, int height, uint32_t seed, int steps, domain_result_t* out);
+// runs the same scene split across ranks local processes, gathering the world at the end.
+// false if the platform can't fork or the world is too short for that many bands
+bool domainRun(int ranks, int width, int height, uint32_t seed, int steps, domain_result_t* out);
+
+#endif
@@ -0,0 +1,137 @@
+#include "edit.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+int circleSpan(int radius, int dy) {
+    int room = radius * radius - dy * dy - 1;
+    if (room < 0) return -1;
+    int half = (int) sqrt((double) room);
+    while (half * half > room) half--;
+    while ((half + 1) * (half + 1) <= room) half++;
+    return half;
+}
+
+int fillCircle(world_t* w, int y, int x, int radius, particle_t p) {
+    if (radius <= 0) return 0;
+    span_t* spans = malloc((2 * radius - 1) * sizeof(span_t));
+    int count = 0;
+    for (int dy = 1 - radius; dy < radius; dy++) {
+        int half = circleSpan(radius, dy);
+        spans[count++] = (span_t) { y + dy, x - half, x + half + 1 };
+    }
+    int changed = setSpans(w, spans, count, p);
+    free(spans);
+    return changed;
+}
+
+// growable list of spans
+typedef struct span_list {
+    span_t* spans;
+    int count;
+    int capacity;
+} span_list_t;
+
+static void addSpan(span_list_t* l, int y, int x0, int x1) {
+    if (l->count == l->capacity) {
+        l->capacity = l->capacity ? l->capacity * 2 : 256;
+        l->spans = realloc(l->spans, l->capacity * sizeof(span_t));
+    }
+    l->spans[l->count++] = (span_t) { y, x0, x1 };
+}
+
+// a crossing clamped to just outside the world, so it always fits in an int
+static int columnOf(const world_t* w, double x) {
+    x = ceil(x - 0.5);
+    return x < -1 ? -1 : x > w->width + 1 ? w->width + 1 : (int) x;
+}
+
+int fillPolygon(world_t* w, const vertex_t* vertices, int count, particle_t p) {
+    if (count < 3) return 0;
+    double top = vertices[0].y, bottom = vertices[0].y;
+    for (int i = 1; i < count; i++) {
+        if (vertices[i].y < top) top = vertices[i].y;
+        if (vertices[i].y > bottom) bottom = vertices[i].y;
+    }
+    int y0 = top > 0 ? (int) floor(top) : 0;
+    int y1 = bottom < w->height ? (int) ceil(bottom) : w->height;
+
+    // where each row's center line crosses the edges, paired up left to right
+    double* crossings = malloc(count * sizeof(double));
+    span_list_t list = { 0 };
+    for (int y = y0; y < y1; y++) {
+        double center = y + 0.5;
+        int n = 0;
+        for (int i = 0; i < count; i++) {
+            vertex_t a = vertices[i], b = vertices[(i + 1) % count];
+            if ((a.y <= center) == (b.y <= center)) continue;
+            double x = a.x + (center - a.y) * (b.x - a.x) / (b.y - a.y);
+            int k = n++;
+            for (; k > 0 && crossings[k - 1] > x; k--) crossings[k] = crossings[k - 1];
+            crossings[k] = x;
+        }
+        for (int k = 0; k + 1 < n; k += 2) {
+            addSpan(&list, y, columnOf(w, crossings[k]), columnOf(w, crossings[k + 1]));
+        }
+    }
+    int changed = setSpans(w, list.spans, list.count, p);
+    free(list.spans);
+    free(crossings);
+    return changed;
+}
+
+// cell (y, x) is filled like the region and not taken yet
+static bool inRegion(const world_t* w, const uint64_t* seen, bool filled, int y, int x) {
+    size_t i = (size_t) y * w->width + x;
+    return !((seen[i >> 6] >> (i & 63)) & 1) && w->cells[cellIndex(w, y, x)].e == filled;
+}
+
+int floodFill(world_t* w, int y, int x, particle_t p) {
+    if (!inRange(w, y, x)) return 0;
+    bool filled = at(w, y, x).e;
+    uint64_t* seen = calloc(((size_t) w->width * w->height + 63) / 64, sizeof(uint64_t));
+    // cells a span of the region grows from, and the spans found
+    span_list_t seeds = { 0 }, region = { 0 };
+    addSpan(&seeds, y, x, x + 1);
+
+    while (seeds.count) {
+        seeds.count--;
+        y = seeds.spans[seeds.count].y;
+        x = seeds.spans[seeds.count].x0;
+        if (!inRegion(w, seen, filled, y, x)) continue;
+        int x0 = x, x1 = x + 1;
+        while (x0 > 0 && inRegion(w, seen, filled, y, x0 - 1)) x0--;
+        while (x1 < w->width && inRegion(w, seen, filled, y, x1)) x1++;
+        for (int k = x0; k < x1; k++) {
+            size_t i = (size_t) y * w->width + k;
+            seen[i >> 6] |= (uint64_t) 1 << (i & 63);
+        }
+        addSpan(&region, y, x0, x1);
+
+        // a seed at the start of every run of the region above and below the span
+        for (int ny = y - 1; ny <= y + 1; ny += 2) {
+            if (ny < 0 || ny >= w->height) continue;
+            bool run = false;
+            for (int k = x0; k < x1; k++) {
+                bool in = inRegion(w, seen, filled, ny, k);
+                if (in && !run) addSpan(&seeds, ny, k, k + 1);
+                run = in;
+            }
+        }
+    }
+
+    // the spans in order of row for setSpans()
+    int* rows = calloc(w->height + 1, sizeof(int));
+    for (int i = 0; i < region.count; i++) rows[region.spans[i].y + 1]++;
+    for (int i = 0; i < w->height; i++) rows[i + 1] += rows[i];
+    span_t* sorted = malloc(region.count * sizeof(span_t));
+    for (int i = 0; i < region.count; i++) sorted[rows[region.spans[i].y]++] = region.spans[i];
+    int changed = setSpans(w, sorted, region.count, p);
+
+    free(sorted);
+    free(rows);
+    free(seeds.spans);
+    free(region.spans);
+    free(seen);
+    return changed;
+}
@@ -0,0 +1,29 @@
+#ifndef SANDSIM_EDIT_H
+#define SANDSIM_EDIT_H
+
+#include "sim.h"
+
+// edits over many cells at once. each shape is cut into row spans written with
+// setSpans(), so the bookkeeping is done a span or a chunk at a time instead of a cell
+// at a time. fill with EMPTY to erase. every edit is clipped to the world and returns
+// the number of cells that went from empty to filled or back
+
+// a corner of a polygon, in cell units. (y, x) is the top left corner of cell (y, x)
+typedef struct vertex {
+    double y;
+    double x;
+} vertex_t;
+
+// half the width of row dy of a disc centered on a cell: the cells up to that many
+// columns either side of the center are closer to it than radius. -1 if the row
+// misses the disc
+int circleSpan(int radius, int dy);
+// cells closer to (y, x) than radius, the same disc the brush paints
+int fillCircle(world_t* w, int y, int x, int radius, particle_t p);
+// cells whose centers are inside the polygon, by the even-odd rule
+int fillPolygon(world_t* w, const vertex_t* vertices, int count, particle_t p);
+// the cells joined to (y, x) through edges that are filled if it is filled and empty if
+// it is empty, so a pile can be erased or a cavity filled in one go
+int floodFill(world_t* w, int y, int x, particle_t p);
+
+#endif
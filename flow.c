@@ -0,0 +1,292 @@
+#include "flow.h"
+#include "edit.h"
+#include "scene.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void flowInit(flow_t* f) {
+    memset(f, 0, sizeof(*f));
+}
+
+void flowFree(flow_t* f) {
+    free(f->emitters);
+    free(f->sinks);
+    memset(f, 0, sizeof(*f));
+}
+
+void flowAddEmitter(flow_t* f, shape_t shape, float rate) {
+    f->emitters = realloc(f->emitters, (f->emitterCount + 1) * sizeof(emitter_t));
+    int y0, y1;
+    shapeRows(&shape, &y0, &y1);
+    f->emitters[f->emitterCount++] = (emitter_t) { shape, rate, 0, y0, 0 };
+}
+
+void flowAddSink(flow_t* f, shape_t shape, int rate) {
+    f->sinks = realloc(f->sinks, (f->sinkCount + 1) * sizeof(sink_t));
+    f->sinks[f->sinkCount++] = (sink_t) { shape, rate };
+}
+
+void flowClear(flow_t* f) {
+    f->emitterCount = 0;
+    f->sinkCount = 0;
+}
+
+void shapeRows(const shape_t* s, int* y0, int* y1) {
+    if (s->kind == SHAPE_DISC) {
+        *y0 = s->y - s->radius + 1;
+        *y1 = s->y + s->radius;
+    } else {
+        *y0 = s->y;
+        *y1 = s->y + s->height;
+    }
+}
+
+bool shapeSpan(const shape_t* s, int y, int* x0, int* x1) {
+    if (s->kind == SHAPE_DISC) {
+        int half = circleSpan(s->radius, y - s->y);
+        if (half < 0) return false;
+        *x0 = s->x - half;
+        *x1 = s->x + half + 1;
+    } else {
+        if (y < s->y || y >= s->y + s->height) return false;
+        *x0 = s->x;
+        *x1 = s->x + s->width;
+    }
+    return *x0 < *x1;
+}
+
+// the part of the shape's span in row y inside the world
+static bool clippedSpan(const world_t* w, const shape_t* s, int y, int* x0, int* x1) {
+    if (y < 0 || y >= w->height || !shapeSpan(s, y, x0, x1)) return false;
+    if (*x0 < 0) *x0 = 0;
+    if (*x1 > w->width) *x1 = w->width;
+    return *x0 < *x1;
+}
+
+// fill up to limit empty cells of row y in [x0, x1) with fresh grains, from the left.
+// each run of empty cells gets its colors grain by grain and is written as one span.
+// returns the number filled and where it stopped in *end
+static int fillRun(world_t* w, int y, int x0, int x1, int limit, int* end) {
+    enum { BATCH = 256 };
+    span_t spans[BATCH];
+    particle_t cells[BATCH];
+    const particle_t* row = &w->cells[cellIndex(w, y, 0)];
+    int filled = 0, count = 0, used = 0;
+    int x = x0;
+    while (x < x1 && filled < limit) {
+        if (row[x].e) {
+            x++;
+            continue;
+        }
+        int start = x;
+        for (; x < x1 && !row[x].e && filled < limit && used < BATCH; x++, filled++) {
+            interpolateColor(w);
+            cells[used++] = (particle_t) { w->currentColor, true, false, 0 };
+        }
+        spans[count++] = (span_t) { y, start, x };
+        if (used == BATCH) {
+            paintSpans(w, spans, count, cells);
+            count = used = 0;
+        }
+    }
+    if (count) paintSpans(w, spans, count, cells);
+    *end = x;
+    return filled;
+}
+
+// empty up to limit filled cells of row y in [x0, x1), from the left
+static int eraseRun(world_t* w, int y, int x0, int x1, int limit) {
+    // all of it in one go, if there is anything to take
+    if (limit >= x1 - x0) return countRect(w, y, x0, y + 1, x1) ? setRect(w, y, x0, y + 1, x1, EMPTY) : 0;
+    const particle_t* row = &w->cells[cellIndex(w, y, 0)];
+    int erased = 0;
+    for (int x = x0; x < x1 && erased < limit; x++) {
+        if (!row[x].e) continue;
+        set(w, y, x, EMPTY);
+        erased++;
+    }
+    return erased;
+}
+
+// fill the grains an emitter owes this update, going on from where it stopped last
+// time and giving up after one round of its shape
+static int emit(world_t* w, emitter_t* e) {
+    e->owed += e->rate;
+    int due = (int) e->owed;
+    e->owed -= due;
+    int y0, y1;
+    shapeRows(&e->shape, &y0, &y1);
+    if (due <= 0 || y0 >= y1) return 0;
+
+    int filled = 0;
+    int y = e->cursorY < y0 || e->cursorY >= y1 ? y0 : e->cursorY;
+    int x = e->cursorX;
+    for (int rows = 0; rows <= y1 - y0 && filled < due; rows++) {
+        int x0, x1;
+        if (clippedSpan(w, &e->shape, y, &x0, &x1)) {
+            if (x < x0) x = x0;
+            int end;
+            filled += fillRun(w, y, x, x1, due - filled, &end);
+            if (filled == due && end < x1) {
+                e->cursorY = y;
+                e->cursorX = end;
+                return filled;
+            }
+        }
+        y = y + 1 < y1 ? y + 1 : y0;
+        x = 0;
+    }
+    e->cursorY = y;
+    e->cursorX = 0;
+    return filled;
+}
+
+static int drain(world_t* w, const sink_t* s) {
+    int limit = s->rate > 0 ? s->rate : w->width * w->height;
+    int y0, y1;
+    shapeRows(&s->shape, &y0, &y1);
+    int erased = 0;
+    for (int y = y0; y < y1 && erased < limit; y++) {
+        int x0, x1;
+        if (clippedSpan(w, &s->shape, y, &x0, &x1)) erased += eraseRun(w, y, x0, x1, limit - erased);
+    }
+    return erased;
+}
+
+void flowApply(flow_t* f, world_t* w) {
+    for (int i = 0; i < f->sinkCount; i++) {
+        f->removed += drain(w, &f->sinks[i]);
+    }
+    for (int i = 0; i < f->emitterCount; i++) {
+        f->emitted += emit(w, &f->emitters[i]);
+    }
+}
+
+int flowStep(flow_t* f, world_t* w) {
+    flowApply(f, w);
+    return UpdateGrid(w);
+}
+
+// a whole word as a number, false if any of it isn't one
+static bool parseInt(const char* word, int* v) {
+    char* end;
+    errno = 0;
+    long n = strtol(word, &end, 10);
+    if (end == word || *end || errno || n < INT_MIN || n > INT_MAX) return false;
+    *v = (int) n;
+    return true;
+}
+
+static bool parseFloat(const char* word, float* v) {
+    char* end;
+    errno = 0;
+    *v = strtof(word, &end);
+    return end != word && !*end && !errno;
+}
+
+static bool parseSeed(const char* word, uint32_t* v) {
+    char* end;
+    errno = 0;
+    unsigned long n = strtoul(word, &end, 10);
+    if (end == word || *end || errno || word[0] == '-' || n > UINT32_MAX) return false;
+    *v = (uint32_t) n;
+    return true;
+}
+
+// a rect or disc shape from the words after the directive, false if they don't make one.
+// *rest is where the words after the shape start
+static bool parseShape(char** words, int count, shape_t* s, int* rest) {
+    if (count < 1) return false;
+    *s = (shape_t) { SHAPE_RECT, 0, 0, 0, 0, 0 };
+    if (strcmp(words[0], "rect") == 0 && count >= 5) {
+        *rest = 5;
+        return parseInt(words[1], &s->y) && parseInt(words[2], &s->x) && parseInt(words[3], &s->height)
+               && parseInt(words[4], &s->width) && s->height > 0 && s->width > 0;
+    }
+    if (strcmp(words[0], "disc") == 0 && count >= 4) {
+        s->kind = SHAPE_DISC;
+        *rest = 4;
+        return parseInt(words[1], &s->y) && parseInt(words[2], &s->x) && parseInt(words[3], &s->radius)
+               && s->radius > 0;
+    }
+    return false;
+}
+
+bool flowLoad(world_t* w, flow_t* f, const char* path) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "can't open %s\n", path);
+        return false;
+    }
+    flowInit(f);
+    bool created = false, ok = true;
+    const char* problem = "bad line";
+    char line[256];
+    int number = 0;
+    while (ok && fgets(line, sizeof(line), file)) {
+        number++;
+        size_t length = strlen(line);
+        if (length == sizeof(line) - 1 && line[length - 1] != '\n' && !feof(file)) {
+            // the rest would be read as a line of its own
+            problem = "line too long";
+            ok = false;
+            continue;
+        }
+        char* comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+        char* words[8];
+        int count = 0;
+        for (char* word = strtok(line, " \t\r\n"); word && count < 8; word = strtok(NULL, " \t\r\n")) {
+            words[count++] = word;
+        }
+        if (count == 0) continue;
+
+        shape_t shape;
+        int rest;
+        if (strcmp(words[0], "world") == 0) {
+            int width = 0, height = 0;
+            uint32_t seed = 1;
+            ok = !created && (count == 3 || count == 4) && parseInt(words[1], &width) && parseInt(words[2], &height)
+                 && (count == 3 || parseSeed(words[3], &seed)) && width > 0 && height > 0;
+            if (ok) {
+                worldInit(w, width, height, seed);
+                created = true;
+            }
+        } else if (!created) {
+            ok = false;
+        } else if (strcmp(words[0], "scene") == 0) {
+            const scene_type_t* scene = count == 2 ? findScene(words[1]) : NULL;
+            ok = scene != NULL;
+            if (ok) scene->setup(w);
+        } else if (strcmp(words[0], "emitter") == 0) {
+            float rate = 0;
+            ok = parseShape(words + 1, count - 1, &shape, &rest) && count == rest + 2
+                 && parseFloat(words[rest + 1], &rate) && rate >= 0;
+            if (ok) flowAddEmitter(f, shape, rate);
+        } else if (strcmp(words[0], "sink") == 0) {
+            int rate = 0;
+            ok = parseShape(words + 1, count - 1, &shape, &rest) && count <= rest + 2
+                 && (count == rest + 1 || parseInt(words[rest + 1], &rate)) && rate >= 0;
+            if (ok) flowAddSink(f, shape, rate);
+        } else {
+            ok = false;
+        }
+    }
+    fclose(file);
+
+    if (ok && !created) {
+        fprintf(stderr, "%s: no world line\n", path);
+        ok = false;
+    } else if (!ok) {
+        fprintf(stderr, "%s:%d: %s\n", path, number, problem);
+    }
+    if (!ok) {
+        if (created) worldFree(w);
+        flowFree(f);
+    }
+    return ok;
+}
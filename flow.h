@@ -0,0 +1,87 @@
+#ifndef SANDSIM_FLOW_H
+#define SANDSIM_FLOW_H
+
+#include <stdbool.h>
+
+#include "sim.h"
+
+// emitters and sinks: shapes fixed in a world that add fresh grains to it or take
+// grains out of it once per update, a row span at a time. an emitter and a sink set
+// a steady load that doesn't depend on anyone holding a mouse button.
+//
+// a scene file sets up a world and its emitters and sinks, a directive per line,
+// '#' to the end of a line is a comment:
+//
+//   world WIDTH HEIGHT [SEED]                  first, the size of the world
+//   scene NAME                                 start from a standard scene, see scene.h
+//   emitter rect Y X HEIGHT WIDTH RATE         RATE grains per update, fractions carry over
+//   emitter disc Y X RADIUS RATE
+//   sink rect Y X HEIGHT WIDTH [RATE]          at most RATE grains per update, all if left out
+//   sink disc Y X RADIUS [RATE]
+
+typedef enum shape_kind {
+    SHAPE_RECT,
+    SHAPE_DISC,
+} shape_kind_t;
+
+typedef struct shape {
+    shape_kind_t kind;
+    // top left corner of a rect, center of a disc
+    int y;
+    int x;
+    // size of a rect
+    int height;
+    int width;
+    // radius of a disc
+    int radius;
+} shape_t;
+
+typedef struct emitter {
+    shape_t shape;
+    // grains per update
+    float rate;
+    // fraction of a grain carried over to the next update
+    float owed;
+    // cell of the shape filling goes on from, so a slow emitter spreads over all of it
+    int cursorY;
+    int cursorX;
+} emitter_t;
+
+typedef struct sink {
+    shape_t shape;
+    // most grains taken per update, 0 for every grain in the shape
+    int rate;
+} sink_t;
+
+typedef struct flow {
+    emitter_t* emitters;
+    int emitterCount;
+    sink_t* sinks;
+    int sinkCount;
+    // grains added and taken so far
+    long long emitted;
+    long long removed;
+} flow_t;
+
+void flowInit(flow_t* f);
+void flowFree(flow_t* f);
+void flowAddEmitter(flow_t* f, shape_t shape, float rate);
+void flowAddSink(flow_t* f, shape_t shape, int rate);
+// drop every emitter and sink
+void flowClear(flow_t* f);
+
+// rows [y0, y1) a shape covers
+void shapeRows(const shape_t* s, int* y0, int* y1);
+// columns [x0, x1) a shape covers in row y, false if none
+bool shapeSpan(const shape_t* s, int y, int* x0, int* x1);
+
+// run the sinks, then the emitters, on w. call once before each update
+void flowApply(flow_t* f, world_t* w);
+// flowApply() and then advance w one update
+int flowStep(flow_t* f, world_t* w);
+
+// read a scene file into w and f, neither of which may be initialized yet.
+// false with the reason on stderr if the file can't be read or has a bad line
+bool flowLoad(world_t* w, flow_t* f, const char* path);
+
+#endif
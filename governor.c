@@ -0,0 +1,104 @@
+#include "governor.h"
+
+// weight of the newest measurement in the running averages
+static const double SMOOTHING = 0.2;
+// full quality frames that must fit in a row before leaving reduced quality
+static const int RECOVER_FRAMES = 30;
+// reduced frames between full quality ones drawn to measure it again
+static const int PROBE_FRAMES = 60;
+
+static void average(double* cost, double seconds) {
+    *cost = *cost > 0 ? *cost + (seconds - *cost) * SMOOTHING : seconds;
+}
+
+void governorInit(governor_t* g, double budget, double stepRate, int maxSubsteps) {
+    g->budget = budget;
+    g->stepRate = stepRate;
+    g->maxSubsteps = maxSubsteps;
+    g->stepCost = 0;
+    g->renderCost = 0;
+    g->reducedCost = 0;
+    g->owed = 0;
+    g->substeps = 0;
+    g->reduced = false;
+    g->probe = false;
+    g->roomy = 0;
+    g->sinceFull = 0;
+    g->log = NULL;
+    g->frame = 0;
+    g->dropped = 0;
+    g->calm = RECOVER_FRAMES;
+    g->loggedDropping = false;
+    g->loggedReduced = false;
+}
+
+// updates that fit in the budget next to a render costing render, at least one.
+// just one until an update has been timed
+static int affordable(const governor_t* g, double render) {
+    if (g->stepCost <= 0) return 1;
+    double n = (g->budget - render) / g->stepCost;
+    return n < 1 ? 1 : n > g->maxSubsteps ? g->maxSubsteps : (int) n;
+}
+
+int governorPlan(governor_t* g, double dt) {
+    g->frame++;
+    g->owed += dt * g->stepRate;
+    int want = (int) g->owed;
+    if (want > g->maxSubsteps) want = g->maxSubsteps;
+
+    // a reduced render is a quarter of the pixels until it has been measured
+    double reducedCost = g->reducedCost > 0 ? g->reducedCost : g->renderCost / 4;
+    int full = affordable(g, g->renderCost);
+    if (full >= want) {
+        if (g->reduced && ++g->roomy >= RECOVER_FRAMES) g->reduced = false;
+    } else {
+        g->roomy = 0;
+        if (affordable(g, reducedCost) > full) g->reduced = true;
+    }
+    g->probe = g->reduced && g->sinceFull >= PROBE_FRAMES;
+    int allowed = governorReduced(g) ? affordable(g, reducedCost) : full;
+
+    g->substeps = want < allowed ? want : allowed;
+    // behind: drop what doesn't fit rather than owe it to every later frame. nothing
+    // is dropped before an update has been timed
+    int dropped = g->stepCost > 0 ? (int) g->owed - g->substeps : 0;
+    g->owed -= g->substeps + dropped;
+    g->dropped += dropped;
+    if (dropped > 0) {
+        g->calm = 0;
+    } else if (g->calm < RECOVER_FRAMES) {
+        g->calm++;
+    }
+
+    // dropping counts as over once no update has been dropped for a while
+    bool dropping = g->calm < RECOVER_FRAMES;
+    if (g->log && (dropping != g->loggedDropping || g->reduced != g->loggedReduced)) {
+        fprintf(g->log, "frame %ld: %s, %s quality, update %.3f ms, render %.3f ms", g->frame,
+                dropping ? "dropping updates" : "keeping up", g->reduced ? "reduced" : "full", g->stepCost * 1e3,
+                (g->reduced ? reducedCost : g->renderCost) * 1e3);
+        if (!dropping && g->loggedDropping) fprintf(g->log, ", %ld updates dropped", g->dropped);
+        fprintf(g->log, "\n");
+        if (!dropping) g->dropped = 0;
+        g->loggedDropping = dropping;
+        g->loggedReduced = g->reduced;
+    }
+    return g->substeps;
+}
+
+void governorStepped(governor_t* g, int steps, double seconds) {
+    if (steps > 0) average(&g->stepCost, seconds / steps);
+}
+
+void governorRendered(governor_t* g, bool reduced, double seconds) {
+    if (reduced) {
+        average(&g->reducedCost, seconds);
+        g->sinceFull++;
+    } else if (g->sinceFull >= PROBE_FRAMES) {
+        // the first full quality frame in a while replaces what was measured long ago
+        g->renderCost = seconds;
+        g->sinceFull = 0;
+    } else {
+        average(&g->renderCost, seconds);
+        g->sinceFull = 0;
+    }
+}
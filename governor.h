@@ -0,0 +1,65 @@
+#ifndef SANDSIM_GOVERNOR_H
+#define SANDSIM_GOVERNOR_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+// decides how many updates to run before each presented frame so a frame stays
+// within its time budget. the simulation is owed updates at a fixed rate of wall
+// time; when the updates owed plus the render don't fit, fewer are run and the rest
+// are dropped, so a heavy world slows down instead of stuttering. when even that
+// isn't enough the frame is drawn at reduced quality until there is room again.
+// costs are measured as the frames run
+
+typedef struct governor {
+    // time per presented frame, seconds
+    double budget;
+    // updates per second of wall time the simulation should advance by
+    double stepRate;
+    // never run more than this many updates for one frame
+    int maxSubsteps;
+
+    // running averages of one update and of one render at each quality, seconds.
+    // 0 until measured
+    double stepCost;
+    double renderCost;
+    double reducedCost;
+    // updates owed, fractions carried to the next frame
+    double owed;
+
+    // decided by the last governorPlan()
+    int substeps;
+    bool reduced;
+    // while reduced, this frame is drawn at full quality anyway to measure it again.
+    // renderCost only changes on full quality frames, so without these it would stay
+    // whatever it was when quality dropped
+    bool probe;
+    // frames in a row that would have fit at full quality
+    int roomy;
+    // frames drawn reduced since the last full quality one
+    int sinceFull;
+
+    // frames since an update was last dropped, and updates dropped since last logged
+    int calm;
+    long dropped;
+
+    // decisions are written here when they change, may be NULL
+    FILE* log;
+    long frame;
+    bool loggedDropping;
+    bool loggedReduced;
+} governor_t;
+
+void governorInit(governor_t* g, double budget, double stepRate, int maxSubsteps);
+// plan the frame presented dt seconds after the last one. returns the number of updates
+// to run, governorReduced() says whether to draw it at reduced quality
+int governorPlan(governor_t* g, double dt);
+// draw the planned frame at reduced quality
+static inline bool governorReduced(const governor_t* g) {
+    return g->reduced && !g->probe;
+}
+// report what running the planned updates and the render took
+void governorStepped(governor_t* g, int steps, double seconds);
+void governorRendered(governor_t* g, bool reduced, double seconds);
+
+#endif
@@ -0,0 +1,148 @@
+#include "heat.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+float MELT_POINT = 1.0f;
+float GLASS_POINT = 0.25f;
+RGBTRIPLE MOLTEN_COLOR = { 40, 140, 255 };
+RGBTRIPLE GLASS_COLOR = { 225, 220, 175 };
+
+void heatInit(heat_t* h, const world_t* w, int shift) {
+    h->shift = shift;
+    h->width = ((w->width - 1) >> shift) + 1;
+    h->height = ((w->height - 1) >> shift) + 1;
+    h->stride = h->width + 2;
+    size_t blocks = (size_t) h->stride * (h->height + 2);
+    h->t = calloc(blocks, sizeof(float));
+    h->next = calloc(blocks, sizeof(float));
+    h->molten = calloc(blocks, sizeof(uint8_t));
+    h->conduction = 0.5f;
+    h->cooling = 0.002f;
+    h->every = 4;
+}
+
+void heatFree(heat_t* h) {
+    free(h->t);
+    free(h->next);
+    free(h->molten);
+    h->t = NULL;
+    h->next = NULL;
+    h->molten = NULL;
+}
+
+void heatAdd(heat_t* h, int y, int x, float amount) {
+    if (y < 0 || x < 0 || (y >> h->shift) >= h->height || (x >> h->shift) >= h->width) return;
+    h->t[((y >> h->shift) + 1) * h->stride + (x >> h->shift) + 1] += amount;
+}
+
+// the border mirrors its neighbour, so no heat flows through the edges
+static void fillBorder(heat_t* h) {
+    float* t = h->t;
+    int s = h->stride;
+    memcpy(t + 1, t + s + 1, h->width * sizeof(float));
+    memcpy(t + (size_t) (h->height + 1) * s + 1, t + (size_t) h->height * s + 1, h->width * sizeof(float));
+    for (int i = 1; i <= h->height; i++) {
+        t[i * s] = t[i * s + 1];
+        t[i * s + h->width + 1] = t[i * s + h->width];
+    }
+}
+
+// 5 point stencil. four blocks of straight line code at a time, which the compiler
+// turns into one 4 wide vector operation each even where it won't vectorize loops
+static void diffuseRow(const float* restrict up, const float* restrict row, const float* restrict down,
+                       float* restrict out, int width, float keep, float share) {
+    int j = 1;
+    for (; j + 3 <= width; j += 4) {
+        out[j] = row[j] * keep + (up[j] + down[j] + row[j - 1] + row[j + 1]) * share;
+        out[j + 1] = row[j + 1] * keep + (up[j + 1] + down[j + 1] + row[j] + row[j + 2]) * share;
+        out[j + 2] = row[j + 2] * keep + (up[j + 2] + down[j + 2] + row[j + 1] + row[j + 3]) * share;
+        out[j + 3] = row[j + 3] * keep + (up[j + 3] + down[j + 3] + row[j + 2] + row[j + 4]) * share;
+    }
+    for (; j <= width; j++) {
+        out[j] = row[j] * keep + (up[j] + down[j] + row[j - 1] + row[j + 1]) * share;
+    }
+}
+
+void heatDiffuse(heat_t* h) {
+    fillBorder(h);
+    float loss = 1.0f - h->cooling;
+    float keep = (1.0f - h->conduction) * loss;
+    float share = h->conduction * 0.25f * loss;
+    int s = h->stride;
+    for (int i = 1; i <= h->height; i++) {
+        const float* row = h->t + (size_t) i * s;
+        diffuseRow(row - s, row, row + s, h->next + (size_t) i * s, h->width, keep, share);
+    }
+    float* swap = h->t;
+    h->t = h->next;
+    h->next = swap;
+}
+
+static void recolor(world_t* w, int y0, int x0, int size, RGBTRIPLE color) {
+    COLORREF c = RGB(color.rgbtRed, color.rgbtGreen, color.rgbtBlue);
+    int y1 = y0 + size < w->height ? y0 + size : w->height;
+    int x1 = x0 + size < w->width ? x0 + size : w->width;
+    for (int i = y0; i < y1; i++) {
+        particle_t* row = &w->cells[cellIndex(w, i, 0)];
+        for (int j = x0; j < x1; j++) {
+            if (!row[j].e || row[j].c == c) continue;
+            touchChunk(w, i, j);
+            row[j].c = c;
+        }
+    }
+}
+
+// molten grains run: each one resting on something moves a cell sideways into an empty
+// cell of a molten block, all of them the same way this pass and visited against it so
+// none moves twice. falling is left to the update
+static void flow(const heat_t* h, world_t* w, int y0, int x0, int size, int dir) {
+    int y1 = y0 + size < w->height ? y0 + size : w->height;
+    int x1 = x0 + size < w->width ? x0 + size : w->width;
+    for (int i = y1 - 1; i >= y0; i--) {
+        for (int k = x0; k < x1; k++) {
+            int j = dir > 0 ? x0 + x1 - 1 - k : k;
+            int nx = j + dir;
+            if (!at(w, i, j).e || nx < 0 || nx >= w->width || at(w, i, nx).e) continue;
+            if (i + 1 < w->height && !at(w, i + 1, j).e) continue;
+            if (!h->molten[((i >> h->shift) + 1) * h->stride + (nx >> h->shift) + 1]) continue;
+            moveGrain(w, i, j, i, nx);
+        }
+    }
+}
+
+void heatApply(heat_t* h, world_t* w) {
+    int size = 1 << h->shift;
+    // alternate the way molten grains run from one pass to the next
+    int dir = (w->step / h->every) & 1 ? 1 : -1;
+    for (int by = 0; by < h->height; by++) {
+        const float* t = h->t + (size_t) (by + 1) * h->stride + 1;
+        uint8_t* molten = h->molten + (size_t) (by + 1) * h->stride + 1;
+        for (int k = 0; k < h->width; k++) {
+            int bx = dir > 0 ? h->width - 1 - k : k;
+            if (t[bx] >= MELT_POINT) {
+                molten[bx] = 1;
+                recolor(w, by << h->shift, bx << h->shift, size, MOLTEN_COLOR);
+                flow(h, w, by << h->shift, bx << h->shift, size, dir);
+            } else if (molten[bx] && t[bx] < GLASS_POINT) {
+                molten[bx] = 0;
+                recolor(w, by << h->shift, bx << h->shift, size, GLASS_COLOR);
+            }
+        }
+    }
+}
+
+void heatUpdate(heat_t* h, world_t* w) {
+    if (w->step % h->every) return;
+    heatDiffuse(h);
+    heatApply(h, w);
+}
+
+double heatTotal(const heat_t* h) {
+    double total = 0;
+    for (int i = 1; i <= h->height; i++) {
+        const float* row = h->t + (size_t) i * h->stride;
+        for (int j = 1; j <= h->width; j++) total += row[j];
+    }
+    return total;
+}
@@ -0,0 +1,58 @@
+#ifndef SANDSIM_HEAT_H
+#define SANDSIM_HEAT_H
+
+#include "sim.h"
+
+// temperature kept apart from the grid, one value per 2^shift x 2^shift block of
+// cells, with a border block all around holding a copy of its neighbour so the edges
+// don't leak. every few world updates it diffuses one step and the grains in blocks
+// hot enough melt and run sideways like a liquid, and once a molten block cools down
+// they are left as glass.
+// temperatures are relative to the ambient, 0
+
+typedef struct heat {
+    int shift;
+    // blocks across/down, and per row with the border
+    int width;
+    int height;
+    int stride;
+    // temperature per block, and the buffer the next diffusion step is written to
+    float* t;
+    float* next;
+    // set on a block once it melted, until it cools to glass
+    uint8_t* molten;
+
+    // share of the difference to the mean of the 4 neighbours a block takes per step
+    float conduction;
+    // share of its temperature a block loses to the ambient per step
+    float cooling;
+    // world updates per diffusion step
+    int every;
+} heat_t;
+
+// temperature grains melt at, and a molten block has to cool below to set
+extern float MELT_POINT;
+extern float GLASS_POINT;
+extern RGBTRIPLE MOLTEN_COLOR;
+extern RGBTRIPLE GLASS_COLOR;
+
+void heatInit(heat_t* h, const world_t* w, int shift);
+void heatFree(heat_t* h);
+
+// temperature of the block holding cell (y, x)
+static inline float heatAt(const heat_t* h, int y, int x) {
+    return h->t[((y >> h->shift) + 1) * h->stride + (x >> h->shift) + 1];
+}
+
+// add amount to the block holding cell (y, x)
+void heatAdd(heat_t* h, int y, int x, float amount);
+// one diffusion step over every block
+void heatDiffuse(heat_t* h);
+// melt, run and set the grains of w by the temperature of their block
+void heatApply(heat_t* h, world_t* w);
+// call once per world update, diffuses and applies every h->every updates
+void heatUpdate(heat_t* h, world_t* w);
+// sum of every block's temperature
+double heatTotal(const heat_t* h);
+
+#endif
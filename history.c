@@ -0,0 +1,282 @@
+#include "history.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static history_frame_t* frameAt(const history_t* h, int i) {
+    return &h->frames[(h->first + i) % h->capacity];
+}
+
+// empty cells are all the same whatever else they hold
+static bool sameCell(particle_t a, particle_t b) {
+    return a.e == b.e && (!a.e || (a.c == b.c && a.a == b.a && a.v == b.v));
+}
+
+static void putCell(buffer_t* b, particle_t p) {
+    if (!p.e) {
+        putVarint(b, 0);
+        return;
+    }
+    putVarint(b, 1 | (uint32_t) p.a << 1 | (uint32_t) p.v << 2);
+    putVarint(b, p.c);
+}
+
+static bool getCell(const uint8_t** p, const uint8_t* end, particle_t* cell) {
+    uint32_t bits, color;
+    if (!getVarint(p, end, &bits)) return false;
+    if (!bits) {
+        *cell = EMPTY;
+        return true;
+    }
+    if (!getVarint(p, end, &color)) return false;
+    *cell = (particle_t) { color, true, (bits >> 1) & 1, (uint16_t) (bits >> 2) };
+    return true;
+}
+
+static void copyShadow(history_t* h, const world_t* w) {
+    for (int y = 0; y < w->height; y++) {
+        memcpy(&h->shadow[(size_t) y * w->width], &w->cells[cellIndex(w, y, 0)], w->width * sizeof(particle_t));
+    }
+}
+
+// every cell of w, in runs of equal cells
+static void encodeKey(const world_t* w, buffer_t* out) {
+    particle_t last = EMPTY;
+    uint32_t run = 0;
+    for (int y = 0; y < w->height; y++) {
+        const particle_t* row = &w->cells[cellIndex(w, y, 0)];
+        for (int x = 0; x < w->width; x++) {
+            if (run && sameCell(row[x], last)) {
+                run++;
+                continue;
+            }
+            if (run) {
+                putVarint(out, run);
+                putCell(out, last);
+            }
+            last = row[x];
+            run = 1;
+        }
+    }
+    if (run) {
+        putVarint(out, run);
+        putCell(out, last);
+    }
+}
+
+// the cells of w that differ from the shadow, looking only in chunks written since the
+// last frame, and the shadow brought up to date with them
+static void encodeChanges(history_t* h, const world_t* w, buffer_t* out) {
+    uint32_t end = 0;
+    for (int cy = 0; cy < w->chunksY; cy++) {
+        const uint32_t* stamps = &w->chunkStamp[cy * w->chunksX];
+        int y1 = (cy + 1) << CHUNK_SHIFT < w->height ? (cy + 1) << CHUNK_SHIFT : w->height;
+        for (int y = cy << CHUNK_SHIFT; y < y1; y++) {
+            const particle_t* row = &w->cells[cellIndex(w, y, 0)];
+            particle_t* old = &h->shadow[(size_t) y * w->width];
+            for (int cx = 0; cx < w->chunksX; cx++) {
+                if (stamps[cx] <= h->since) continue;
+                int x = cx << CHUNK_SHIFT;
+                int x1 = x + CHUNK_SIZE < w->width ? x + CHUNK_SIZE : w->width;
+                while (x < x1) {
+                    if (sameCell(row[x], old[x])) {
+                        x++;
+                        continue;
+                    }
+                    int start = x;
+                    while (x < x1 && !sameCell(row[x], old[x])) x++;
+                    uint32_t at = (uint32_t) y * w->width + start;
+                    putVarint(out, at - end);
+                    putVarint(out, x - start);
+                    for (int k = start; k < x; k++) {
+                        putCell(out, row[k]);
+                        putCell(out, old[k]);
+                    }
+                    memcpy(old + start, row + start, (x - start) * sizeof(particle_t));
+                    end = at + (x - start);
+                }
+            }
+        }
+    }
+}
+
+// write cell at of w as a frame has it, in the shadow as well
+static void putBack(history_t* h, world_t* w, uint32_t at, particle_t p) {
+    int y = at / w->width, x = at % w->width;
+    if (!sameCell(w->cells[cellIndex(w, y, x)], p)) set(w, y, x, p);
+    h->shadow[at] = p;
+}
+
+// bring the cells of w from the frame before f to f, or with undo from f back to the
+// frame before. a keyframe sets every cell and can't be undone
+static void replayCells(history_t* h, world_t* w, const history_frame_t* f, bool undo) {
+    const uint8_t* p = f->data;
+    const uint8_t* end = f->data + f->size;
+    uint32_t cells = (uint32_t) w->width * w->height;
+    uint32_t at = 0;
+    while (p < end) {
+        uint32_t skip = 0, run;
+        if (!f->key && !getVarint(&p, end, &skip)) return;
+        if (!getVarint(&p, end, &run)) return;
+        at += skip;
+        particle_t cell, was;
+        if (f->key) {
+            if (!getCell(&p, end, &cell)) return;
+            for (uint32_t k = 0; k < run && at < cells; k++) putBack(h, w, at++, cell);
+            continue;
+        }
+        for (uint32_t k = 0; k < run && at < cells; k++) {
+            if (!getCell(&p, end, &cell) || !getCell(&p, end, &was)) return;
+            putBack(h, w, at++, undo ? was : cell);
+        }
+    }
+}
+
+// the rest of w as it was at frame f
+static void restoreFrame(world_t* w, const history_frame_t* f) {
+    w->step = f->step;
+    w->colorPercent = f->colorPercent;
+    w->colorDirection = f->colorDirection;
+    w->currentColor = f->currentColor;
+}
+
+// the scratch buffer as the newest frame, taken of w
+static void pushFrame(history_t* h, const world_t* w, bool key) {
+    if (h->count == h->capacity) {
+        int capacity = h->capacity ? h->capacity * 2 : 64;
+        history_frame_t* frames = malloc(capacity * sizeof(history_frame_t));
+        for (int i = 0; i < h->count; i++) {
+            frames[i] = *frameAt(h, i);
+        }
+        free(h->frames);
+        h->frames = frames;
+        h->capacity = capacity;
+        h->first = 0;
+    }
+    history_frame_t* f = frameAt(h, h->count);
+    *f = (history_frame_t) { w->step, key, w->colorPercent, w->colorDirection, w->currentColor, NULL, h->scratch.size };
+    if (f->size) {
+        f->data = malloc(f->size);
+        memcpy(f->data, h->scratch.data, f->size);
+    }
+    h->bytes += f->size;
+    h->position = h->count++;
+}
+
+static void dropOldest(history_t* h) {
+    history_frame_t* f = frameAt(h, 0);
+    h->bytes -= f->size;
+    free(f->data);
+    h->first = (h->first + 1) % h->capacity;
+    h->count--;
+    h->position--;
+}
+
+static void dropNewest(history_t* h) {
+    history_frame_t* f = frameAt(h, h->count - 1);
+    h->bytes -= f->size;
+    free(f->data);
+    h->count--;
+}
+
+void historyInit(history_t* h, world_t* w, size_t limit, int keyEvery) {
+    memset(h, 0, sizeof(*h));
+    h->width = w->width;
+    h->height = w->height;
+    h->limit = limit;
+    h->keyEvery = keyEvery > 0 ? keyEvery : 1;
+    h->shadow = malloc((size_t) w->width * w->height * sizeof(particle_t));
+    copyShadow(h, w);
+    encodeKey(w, &h->scratch);
+    h->since = nextEpoch(w);
+    pushFrame(h, w, true);
+}
+
+void historyFree(history_t* h) {
+    while (h->count) dropNewest(h);
+    free(h->frames);
+    free(h->shadow);
+    bufferFree(&h->scratch);
+    memset(h, 0, sizeof(*h));
+}
+
+void historyRecord(history_t* h, world_t* w) {
+    // frames past the one w was moved back to are a future that didn't happen
+    while (h->count > h->position + 1) dropNewest(h);
+    int sinceKey = 0;
+    while (!frameAt(h, h->count - 1 - sinceKey)->key) sinceKey++;
+    // with only one keyframe left over the limit, a new one lets it go
+    bool key = sinceKey + 1 >= h->keyEvery || h->bytes > h->limit;
+
+    h->scratch.size = 0;
+    if (key) {
+        encodeKey(w, &h->scratch);
+        copyShadow(h, w);
+    } else {
+        encodeChanges(h, w, &h->scratch);
+    }
+    h->since = nextEpoch(w);
+    pushFrame(h, w, key);
+
+    // the oldest keyframe and the deltas on it go while over the limit, never the newest
+    while (h->bytes > h->limit) {
+        int next = 1;
+        while (next < h->count && !frameAt(h, next)->key) next++;
+        if (next == h->count) break;
+        for (; next > 0; next--) dropOldest(h);
+    }
+}
+
+uint32_t historySeek(history_t* h, world_t* w, uint32_t step) {
+    int lo = 0, hi = h->count - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (frameAt(h, mid)->step <= step) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    int target = lo;
+    int key = target;
+    while (!frameAt(h, key)->key) key--;
+
+    // going from where w is saves the keyframe, unless w was written since it got there
+    bool unchanged = true;
+    for (int c = 0; c < w->chunksX * w->chunksY && unchanged; c++) {
+        unchanged = w->chunkStamp[c] <= h->since;
+    }
+    int from = key;
+    if (unchanged && h->position >= key && h->position <= target) {
+        from = h->position + 1;
+    } else if (unchanged && h->position > target) {
+        // undo deltas back to target, unless a keyframe is in the way
+        int i = h->position;
+        while (i > target && !frameAt(h, i)->key) replayCells(h, w, frameAt(h, i--), true);
+        if (i == target) from = target + 1;
+    }
+    for (int i = from; i <= target; i++) {
+        replayCells(h, w, frameAt(h, i), false);
+    }
+    restoreFrame(w, frameAt(h, target));
+    h->since = nextEpoch(w);
+    h->position = target;
+    return frameAt(h, target)->step;
+}
+
+uint32_t historyOldest(const history_t* h) {
+    return frameAt(h, 0)->step;
+}
+
+uint32_t historyNewest(const history_t* h) {
+    return frameAt(h, h->count - 1)->step;
+}
+
+uint32_t historyStep(const history_t* h) {
+    return frameAt(h, h->position)->step;
+}
+
+size_t historyMemory(const history_t* h) {
+    return h->bytes + h->capacity * sizeof(history_frame_t) + (size_t) h->width * h->height * sizeof(particle_t)
+           + h->scratch.capacity;
+}
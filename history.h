@@ -0,0 +1,77 @@
+#ifndef SANDSIM_HISTORY_H
+#define SANDSIM_HISTORY_H
+
+#include <stddef.h>
+
+#include "sim.h"
+#include "stream.h"
+
+// the updates a world went through, to step back over and replay. a frame is taken
+// after each update: every keyEvery frames a keyframe with every cell, in between a
+// delta with only the cells that changed since the frame before, found by comparing
+// the chunks written since then against a copy of the world as it was.
+//
+// a keyframe is runs of (varint length, cell) over all cells row by row, a delta is
+// runs of (varint cells skipped, varint length, then each cell as it became and as it
+// was) over the changed ones, so stepping back undoes deltas instead of replaying from
+// a keyframe. a cell is varint 0 when empty, else varint 1 | anchored << 1 |
+// fall speed << 2 and then its color as a varint, so a world stepped back to carries
+// on exactly as it did.
+//
+// when the frames take more than the limit the oldest keyframe goes, with the deltas
+// that need it. only the cells and the color gradient are kept, not the heat field
+// or anything else living beside the world
+
+typedef struct history_frame {
+    // updates done when the frame was taken
+    uint32_t step;
+    bool key;
+    // the color gradient as it was
+    double colorPercent;
+    int colorDirection;
+    COLORREF currentColor;
+    uint8_t* data;
+    size_t size;
+} history_frame_t;
+
+typedef struct history {
+    int width;
+    int height;
+    // most bytes of frame data kept
+    size_t limit;
+    // a keyframe every this many frames
+    int keyEvery;
+    // ring of frames, oldest at first
+    history_frame_t* frames;
+    int capacity;
+    int first;
+    int count;
+    // frame the world is at, counted from the oldest
+    int position;
+    // data of every frame
+    size_t bytes;
+    // the world's cells at position, width x height with no border
+    particle_t* shadow;
+    // epoch the world was at position in, chunks stamped after it have been written since
+    uint32_t since;
+    // encoding space reused for every frame
+    buffer_t scratch;
+} history_t;
+
+// start a history of w with a keyframe of it as it is now. limit is in bytes
+void historyInit(history_t* h, world_t* w, size_t limit, int keyEvery);
+void historyFree(history_t* h);
+// take a frame of w after an update. if w was moved back, the frames after that are dropped
+void historyRecord(history_t* h, world_t* w);
+// move w to the newest frame taken at or before step, or to the oldest frame if they are
+// all later. returns the step w is at now
+uint32_t historySeek(history_t* h, world_t* w, uint32_t step);
+
+// steps of the oldest and newest frames and of the one w is at
+uint32_t historyOldest(const history_t* h);
+uint32_t historyNewest(const history_t* h);
+uint32_t historyStep(const history_t* h);
+// bytes held, frames and the copy of the world included
+size_t historyMemory(const history_t* h);
+
+#endif
@@ -5,6 +5,18 @@
 #include <winuser.h>
 #include <math.h>
 #include <stdio.h>
+#include <string.h>
+
+#include "edit.h"
+#include "flow.h"
+#include "governor.h"
+#include "heat.h"
+#include "history.h"
+#include "margolus.h"
+#include "mip.h"
+#include "share.h"
+#include "sim.h"
+#include "stats.h"
 
 // window parameters
 // screen width/height
@@ -15,75 +27,96 @@ int C_WIDTH = 250;
 int C_HEIGHT = 250;
 // brush radius
 int SPAWN_RADIUS = 5;
-// color change per update
-float COLOR_PERCENT = 0.001;
-// update interval
-float TIMER = 1000.0 / 220;
-
-// 3 color gradient options
-/*
-RGBTRIPLE COLOR_1 = { 242, 145, 135 };
-RGBTRIPLE COLOR_2 = { 139, 32, 211 };
-RGBTRIPLE COLOR_3 = { 0, 160, 253 };
-RGBTRIPLE COLOR_1 = { 135, 145, 242 };
-RGBTRIPLE COLOR_2 = { 211, 32, 139 };
-RGBTRIPLE COLOR_3 = { 253, 160, 0 };
-*/
-RGBTRIPLE COLOR_1 = { 106, 86, 75 };
-RGBTRIPLE COLOR_2 = { 142, 131, 87 };
-RGBTRIPLE COLOR_3 = { 156, 196, 72 };
+// frame interval, ms
+float TIMER = 1000.0 / 60;
+// updates per second the world runs at while it keeps up
+float STEP_RATE = 220;
+// most updates run for one frame
+int MAX_SUBSTEPS = 16;
+// the governor's decisions and the frame counters on exit go here, when the command
+// line has --log
+const char* LOG_PATH = "governor.log";
+bool logging = false;
 
 // background color
 RGBTRIPLE BACKGROUND_COLOR = { 0, 0, 0 };
 
-// gradient color going left/right
-int colorDirection = 1;
-
 // function dec.
-void DrawGrid(HDC hdc, RECT rect);
-void UpdateGrid();
-void interpolateColor();
-
-bool inRange(int y, int x) {
-    return y >= 0 && y < C_HEIGHT && x >= 0 && x < C_WIDTH;
-}
-
-// particle struct
-typedef struct particle {
-    COLORREF c; // color
-    bool e; // exists
-    bool a; // anchored
-} particle_t;
+void DrawGrid(RECT rect);
 
 // mouse properties
 POINT mouseLocation;
 bool leftMouseDown = false;
+// dragging the view with the middle button, from where it was last seen
+bool panning = false;
+POINT panFrom;
 bool rightMouseToggle = true;
-
-// grid
-particle_t* grid;
-
-// current color
-COLORREF currentColor = RGB(0, 0, 0);
-
-// percent through gradient
-double colorPercent = 0.0;
-
-// def of empty grid
-particle_t EMPTY = (particle_t) { RGB(0, 0, 0), false, false };
+// brush drops grains onto the column surfaces instead of painting them
+bool dropMode = false;
+// brush heats instead of painting grains
+bool heatMode = false;
+// brush erases instead of painting grains
+bool eraseMode = false;
+// step the world by the 2x2 block rule instead of the classic one
+bool blockMode = false;
+// heat the brush adds per frame to each block under it
+float HEAT_AMOUNT = 0.5f;
+// grains per update from an emitter placed with E
+float EMIT_RATE = 2;
+// most memory the rewind history takes, and frames between its keyframes
+size_t HISTORY_BYTES = 64 << 20;
+int HISTORY_KEY_EVERY = 64;
+// updates stepped over per frame while the left or right arrow is held
+int REPLAY_SPEED = 8;
+// the performance overlay, toggled with P
+bool hudMode = false;
+// -1 while stepping back through the history, 1 while replaying it
+int scrub = 0;
+
+// the simulated world
+world_t world;
+// its reductions for drawing it smaller than a pixel per cell
+mip_t mip;
+// its temperature, per 4x4 block
+heat_t heat;
+// its emitters and sinks
+flow_t flow;
+// its past updates, to step back over
+history_t history;
+// what each frame cost, kept whether or not the overlay shows it
+stats_t stats;
+// the world's cells in shared memory under SHARE_NAME, for other processes to read
+const char* SHARE_NAME = "sandsim";
+share_t share;
+bool shared = false;
+// the part of the world in the window
+camera_t camera;
+// zoom per mouse wheel notch
+double ZOOM_STEP = 1.25;
+// the back buffer's pixels, top row first
+uint32_t* framePixels = NULL;
+// updates per frame and render quality
+governor_t governor;
+LARGE_INTEGER lastFrame;
 
 // window class name
 const char g_szClassName[] = "sandWindowClass";
 
-particle_t at(particle_t* g, int i, int j) {
-    return inRange(i, j) ? g[i * C_HEIGHT + j] : EMPTY;
+// 32 bit top-down bitmap the frame is drawn into directly
+HBITMAP CreateFrame(HDC hdc, int width, int height) {
+    BITMAPINFO info = { 0 };
+    info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    info.bmiHeader.biWidth = width > 0 ? width : 1;
+    info.bmiHeader.biHeight = -(height > 0 ? height : 1);
+    info.bmiHeader.biPlanes = 1;
+    info.bmiHeader.biBitCount = 32;
+    info.bmiHeader.biCompression = BI_RGB;
+    void* bits = NULL;
+    HBITMAP bitmap = CreateDIBSection(hdc, &info, DIB_RGB_COLORS, &bits, NULL, 0);
+    framePixels = bits;
+    return bitmap;
 }
 
-void set(particle_t* g, int i, int j, particle_t val) {
-    if (inRange(i, j)) {
-        g[i * C_HEIGHT + j] = val;
-    }
-}
 // windows setup
 LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
 
@@ -92,6 +125,65 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
     static RECT clientRect;
 
     switch(msg) {
+        case WM_KEYDOWN:
+            if (wParam == 'D') {
+                dropMode = !dropMode;
+            } else if (wParam == 'H') {
+                heatMode = !heatMode;
+            } else if (wParam == 'P') {
+                hudMode = !hudMode;
+            } else if (wParam == 'X') {
+                eraseMode = !eraseMode;
+            } else if (wParam == 'F') {
+                // a pile under the mouse is erased, an empty space is filled
+                double x, y;
+                cameraToWorld(&camera, mouseLocation.x + 0.5, mouseLocation.y + 0.5, &x, &y);
+                int column = (int) floor(x), row = (int) floor(y);
+                interpolateColor(&world);
+                particle_t p = at(&world, row, column).e ? EMPTY : (particle_t) { world.currentColor, true, false, 0 };
+                if (shared) shareBegin(&share);
+                floodFill(&world, row, column, p);
+                if (shared) shareEnd(&share);
+            } else if (wParam == 'M') {
+                blockMode = !blockMode;
+            } else if (wParam == 'E' || wParam == 'S') {
+                // a brush sized emitter or sink under the mouse
+                double x, y;
+                cameraToWorld(&camera, mouseLocation.x + 0.5, mouseLocation.y + 0.5, &x, &y);
+                shape_t disc = { SHAPE_DISC, (int) floor(y), (int) floor(x), 0, 0, SPAWN_RADIUS };
+                if (wParam == 'E') {
+                    flowAddEmitter(&flow, disc, EMIT_RATE);
+                } else {
+                    flowAddSink(&flow, disc, 0);
+                }
+            } else if (wParam == 'C') {
+                flowClear(&flow);
+            } else if (wParam == VK_LEFT || wParam == VK_RIGHT) {
+                scrub = wParam == VK_LEFT ? -1 : 1;
+            } else if (wParam == VK_HOME) {
+                camera = cameraFit(C_WIDTH, C_HEIGHT, clientRect.right, clientRect.bottom);
+            }
+            break;
+        case WM_KEYUP:
+            if (wParam == VK_LEFT || wParam == VK_RIGHT) scrub = 0;
+            break;
+        case WM_MOUSEWHEEL: {
+                // wheel positions are in screen coordinates
+                POINT at = { GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam) };
+                ScreenToClient(hwnd, &at);
+                cameraZoom(&camera, pow(ZOOM_STEP, GET_WHEEL_DELTA_WPARAM(wParam) / (double) WHEEL_DELTA), at.x, at.y);
+            }
+            break;
+        case WM_MBUTTONDOWN:
+            panning = true;
+            panFrom.x = GET_X_LPARAM(lParam);
+            panFrom.y = GET_Y_LPARAM(lParam);
+            SetCapture(hwnd);
+            break;
+        case WM_MBUTTONUP:
+            panning = false;
+            ReleaseCapture();
+            break;
         case WM_RBUTTONDOWN:
             rightMouseToggle = !rightMouseToggle;
             break;
@@ -104,38 +196,56 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
             }
             break;
         case WM_MOUSEMOVE: {
-                if (leftMouseDown) {
-                    mouseLocation.x = GET_X_LPARAM(lParam);
-                    mouseLocation.y = GET_Y_LPARAM(lParam);
+                // followed with no button down too, for placing emitters and sinks
+                mouseLocation.x = GET_X_LPARAM(lParam);
+                mouseLocation.y = GET_Y_LPARAM(lParam);
+                if (panning) {
+                    // the world follows the mouse
+                    cameraPan(&camera, panFrom.x - GET_X_LPARAM(lParam), panFrom.y - GET_Y_LPARAM(lParam));
+                    panFrom.x = GET_X_LPARAM(lParam);
+                    panFrom.y = GET_Y_LPARAM(lParam);
                 }
             }
             break;
         case WM_CREATE:
-            grid = malloc((C_HEIGHT) * (C_WIDTH) * sizeof(particle_t));
-            for (int i = 0; i < C_HEIGHT; i++) {
-                for (int j = 0; j < C_WIDTH; j++) {
-                    set(grid, i, j, EMPTY);
-                }
-            }
+            worldInit(&world, C_WIDTH, C_HEIGHT, GetTickCount());
+            world.worklist = true;
+            mipInit(&mip, &world);
+            heatInit(&heat, &world, 2);
+            flowInit(&flow);
+            shared = shareOpen(&share, &world, SHARE_NAME);
+            historyInit(&history, &world, HISTORY_BYTES, HISTORY_KEY_EVERY);
+            statsInit(&stats, &world);
+            governorInit(&governor, TIMER / 1000.0, STEP_RATE, MAX_SUBSTEPS);
+            if (logging) governor.log = fopen(LOG_PATH, "w");
+            QueryPerformanceCounter(&lastFrame);
             GetClientRect(hwnd, &clientRect);
+            camera = cameraFit(C_WIDTH, C_HEIGHT, clientRect.right, clientRect.bottom);
             hdcBuffer = CreateCompatibleDC(NULL);
-            hBitmap = CreateCompatibleBitmap(GetDC(hwnd), clientRect.right, clientRect.bottom);
+            hBitmap = CreateFrame(hdcBuffer, clientRect.right, clientRect.bottom);
             SelectObject(hdcBuffer, hBitmap);
             break;
         case WM_SIZE: {
-                RECT newClientRect;
-                GetClientRect(hwnd, &newClientRect);
-                if (hBitmap != NULL) {
-                    DeleteObject(hBitmap);
-                }
-                hBitmap = CreateCompatibleBitmap(hdcBuffer, newClientRect.right, newClientRect.bottom);
+                GetClientRect(hwnd, &clientRect);
+                HBITMAP old = hBitmap;
+                hBitmap = CreateFrame(hdcBuffer, clientRect.right, clientRect.bottom);
                 SelectObject(hdcBuffer, hBitmap);
+                if (old != NULL) {
+                    DeleteObject(old);
+                }
             }
             break;
         case WM_CLOSE:
             DestroyWindow(hwnd);
             break;
         case WM_DESTROY:
+            if (governor.log) {
+                statsPrint(&stats, governor.log);
+                fclose(governor.log);
+            }
+            if (shared) shareClose(&share);
+            flowFree(&flow);
+            historyFree(&history);
             DeleteDC(hdcBuffer);
             DeleteObject(hBitmap);
             PostQuitMessage(0);
@@ -144,9 +254,21 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
             PAINTSTRUCT ps;
 
             HDC hdc = BeginPaint(hwnd, &ps);
-            DrawGrid(hdcBuffer, clientRect);
+            DrawGrid(clientRect);
             BitBlt(hdc, 0, 0, clientRect.right, clientRect.bottom, hdcBuffer, 0, 0, SRCCOPY);
 
+            // while the world is back in its history, the title says where
+            static bool rewound = false;
+            bool back = historyStep(&history) != historyNewest(&history);
+            if (back || rewound) {
+                char title[128];
+                snprintf(title, sizeof(title), "Sand Simulation - update %u of %u to %u, history %.1f MB",
+                         historyStep(&history), historyOldest(&history), historyNewest(&history),
+                         historyMemory(&history) / 1048576.0);
+                SetWindowText(hwnd, back ? title : "Sand Simulation");
+                rewound = back;
+            }
+
             EndPaint(hwnd, &ps);
             return 0;
         }
@@ -167,6 +289,8 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
     HWND hwnd;
     MSG Msg;
 
+    logging = strstr(lpCmdLine, "--log") != NULL;
+
     //Step 1: Registering the Window Class
     wc.cbSize        = sizeof(WNDCLASSEX);
     wc.style         = 0;
@@ -216,152 +340,121 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
 }
 
 
-int displace(int y, int x, particle_t* temp) {
-    if (y >= C_HEIGHT - 1) return 2;
-    if (inRange(y + 1, x) && !grid[(y + 1) * C_HEIGHT + x].e && !temp[C_HEIGHT * (y + 1) + x].e) {
-        return 0;
-    }
-    boolean rightPossible = false;
-    boolean leftPossible = false;
-    if (inRange(y + 1, x + 1) && !grid[C_HEIGHT * (y + 1) + x + 1].e && !temp[C_HEIGHT * (y + 1) + x + 1].e) {
-        rightPossible = true;
-    }
-    if (inRange(y + 1, x - 1) && !grid[C_HEIGHT * (y + 1 ) + x - 1].e && !temp[C_HEIGHT * (y + 1) + x - 1].e) {
-        leftPossible = true;
-    }
-    if (rightPossible && leftPossible) {
-        return rand() < 0.5 ? 1 : -1;
-    }
-    if (rightPossible) {
-        return 1;
-    }
-    if (leftPossible) {
-        return -1;
-    }
-    return 2;
+int sq(int v) {
+    return v * v;
 }
 
-void setAnchor(int y, int x, particle_t* g) {
-    // make sure it's not anchored
-    // bottom is empty
-    if (!g[C_HEIGHT * (y + 1) + x].a) {
-        g[C_HEIGHT * y + x].a = false;
-        return;
-    }
-    // bottom left is empty
-    if (inRange(y + 1, x - 1) && !g[C_HEIGHT * (y + 1) + (x - 1)].a) {
-        g[C_HEIGHT * y + x].a = false;
-        return;
-    }
-    // bottom right is empty
-    if (inRange(y + 1, x + 1) && !g[C_HEIGHT * (y + 1) + (x + 1)].a) {
-        g[C_HEIGHT * y + x].a = false;
-        return;
-    }
-    // it cannot move anywhere
-    g[C_HEIGHT * y + x].a = true;
+double secondsSince(LARGE_INTEGER from) {
+    LARGE_INTEGER count, frequency;
+    QueryPerformanceCounter(&count);
+    QueryPerformanceFrequency(&frequency);
+    return (double) (count.QuadPart - from.QuadPart) / frequency.QuadPart;
 }
 
-particle_t* temp;
-void UpdateGrid() {
-    if (temp == NULL) {
-        temp = malloc(C_WIDTH * C_HEIGHT * sizeof(particle_t));
-    }
-
-    for (int i = 0; i < C_HEIGHT; i++) {
-        for (int j = 0; j < C_WIDTH; j++) {
-            set(temp, i, j, EMPTY);
+// spread a width/2 x height/2 picture packed at the start of pixels over all of it,
+// a pixel to each 2x2 block. runs backwards so no source pixel is overwritten early
+void Upscale(uint32_t* pixels, int width, int height) {
+    int half = (width + 1) / 2;
+    for (int y = height - 1; y >= 0; y--) {
+        const uint32_t* from = pixels + (size_t) (y / 2) * half;
+        uint32_t* to = pixels + (size_t) y * width;
+        for (int x = width - 1; x >= 0; x--) {
+            to[x] = from[x / 2];
         }
     }
+}
 
-    for (int i = C_HEIGHT - 1; i > 0; --i) {
-        for (int j = 0; j < C_WIDTH; ++j) {
-            int d = displace(i, j, temp);
-            if (inRange(i + 1, j) && (d == -1 || d == 0 || d == 1)) {
-                temp[C_HEIGHT * (i + 1) + j + d] = grid[C_HEIGHT * i + j];
-                grid[C_HEIGHT * i + j] = EMPTY;
-                temp[C_HEIGHT * i + j] = EMPTY;
+void DrawGrid(RECT rect) {
+    LARGE_INTEGER start;
+    QueryPerformanceCounter(&start);
+    double elapsed = secondsSince(lastFrame);
+    lastFrame = start;
+    int substeps = 0;
+    if (scrub) {
+        // moving through the history in place of updating
+        uint32_t at = historyStep(&history);
+        uint32_t to = scrub > 0 ? at + REPLAY_SPEED : at > (uint32_t) REPLAY_SPEED ? at - REPLAY_SPEED : 0;
+        if (shared) shareBegin(&share);
+        historySeek(&history, &world, to);
+        if (shared) shareEnd(&share);
+    } else if (rightMouseToggle) {
+        substeps = governorPlan(&governor, elapsed);
+        if (shared) shareBegin(&share);
+        for (int s = 0; s < substeps; s++) {
+            flowApply(&flow, &world);
+            if (blockMode) {
+                UpdateGridMargolus(&world);
             } else {
-                temp[C_HEIGHT * i + j] = grid[C_HEIGHT * i + j];
-                grid[C_HEIGHT * i + j] = EMPTY;
+                UpdateGrid(&world);
             }
+            heatUpdate(&heat, &world);
+            // after the heat, so a frame has the recolors its update's melting made
+            historyRecord(&history, &world);
         }
+        if (shared) shareEnd(&share);
+        governorStepped(&governor, substeps, secondsSince(start));
     }
-
-    memcpy(grid, temp, C_WIDTH * C_HEIGHT * sizeof(particle_t));
-}
-
-int sq(int v) {
-    return v * v;
-}
-
-int lerp(BYTE start, BYTE end, float t) {
-    return (int) (start + (end - start) * t);
-}
-
-void interpolateColor() {
-    colorPercent += COLOR_PERCENT * colorDirection;
-    if (colorPercent > 1.0) {
-        colorDirection = -1;
-        colorPercent = 1;
-    }
-    if (colorPercent < 0.0) {
-        colorDirection = 1;
-        colorPercent = 0;
-    }
-
-    if (colorPercent <= 0.50) {
-        currentColor = RGB(
-                    lerp(COLOR_1.rgbtRed, COLOR_2.rgbtRed, colorPercent * 2),
-                    lerp(COLOR_1.rgbtGreen, COLOR_2.rgbtGreen, colorPercent * 2),
-                    lerp(COLOR_1.rgbtBlue, COLOR_2.rgbtBlue, colorPercent * 2)
-                );
-    } else {
-        currentColor = RGB(
-                lerp(COLOR_2.rgbtRed, COLOR_3.rgbtRed,    (colorPercent - 0.50) * 2),
-                lerp(COLOR_2.rgbtGreen, COLOR_3.rgbtGreen,(colorPercent - 0.50) * 2),
-                lerp(COLOR_2.rgbtBlue, COLOR_3.rgbtBlue,  (colorPercent - 0.50) * 2)
-        );
-    }
-}
-
-void DrawGrid(HDC hdc, RECT rect) {
-    if (rightMouseToggle) {
-        UpdateGrid();
-    }
+    double stepSeconds = secondsSince(start);
     int clientWidth = rect.right - rect.left;
     int clientHeight = rect.bottom - rect.top;
-    int cellWidth = floor((double) clientWidth / C_WIDTH);
-    int cellHeight = floor((double) clientHeight / C_HEIGHT);
-
-    const RECT screen = {0, 0, S_WIDTH, S_HEIGHT};
-    HBRUSH brush;
-    brush = CreateSolidBrush(RGB(BACKGROUND_COLOR.rgbtRed, BACKGROUND_COLOR.rgbtGreen, BACKGROUND_COLOR.rgbtBlue));
-    FillRect(hdc, &screen, brush);
-
-    for (int i = 0; i < C_WIDTH; ++i) {
-        for (int j = 0; j < C_HEIGHT; ++j) {
-            int x = i * cellWidth;
-            int y = j * cellHeight;
-
-            if (leftMouseDown) {
-                if (sq(i - mouseLocation.x / cellWidth) + sq(j - mouseLocation.y / cellHeight) < sq(SPAWN_RADIUS)) {
-                    interpolateColor();
-                    grid[C_HEIGHT * j + i] = (particle_t) { currentColor, true, false };
+    if (clientWidth <= 0 || clientHeight <= 0 || framePixels == NULL) return;
+
+    LARGE_INTEGER brushing;
+    QueryPerformanceCounter(&brushing);
+    if (leftMouseDown) {
+        if (shared) shareBegin(&share);
+        double x, y;
+        cameraToWorld(&camera, mouseLocation.x + 0.5, mouseLocation.y + 0.5, &x, &y);
+        int column = (int) floor(x);
+        int row = (int) floor(y);
+        if (heatMode) {
+            for (int j = row - SPAWN_RADIUS + 1; j < row + SPAWN_RADIUS; j += 4) {
+                for (int i = column - SPAWN_RADIUS + 1; i < column + SPAWN_RADIUS; i += 4) {
+                    heatAdd(&heat, j, i, HEAT_AMOUNT);
                 }
             }
-
-            particle_t p = grid[C_HEIGHT * j + i];
-
-            if (p.e) {
-                brush = CreateSolidBrush(p.c);
-
-                FillRect(hdc, &((const RECT) {x, y, x + cellWidth, y + cellHeight}), brush);
-            } else {
-                continue;
+        } else if (eraseMode) {
+            fillCircle(&world, row, column, SPAWN_RADIUS, EMPTY);
+        } else if (dropMode) {
+            for (int i = column - SPAWN_RADIUS + 1; i < column + SPAWN_RADIUS; ++i) {
+                interpolateColor(&world);
+                dropGrain(&world, i, (particle_t) { world.currentColor, true, false, 0 });
+            }
+        } else {
+            for (int j = row - SPAWN_RADIUS + 1; j < row + SPAWN_RADIUS; ++j) {
+                for (int i = column - SPAWN_RADIUS + 1; i < column + SPAWN_RADIUS; ++i) {
+                    if (sq(i - column) + sq(j - row) >= sq(SPAWN_RADIUS) || !inRange(&world, j, i)) continue;
+                    interpolateColor(&world);
+                    set(&world, j, i, (particle_t) { world.currentColor, true, false, 0 });
+                }
             }
-
-            DeleteObject(brush);
         }
+        if (shared) shareEnd(&share);
+    }
+
+    double brushSeconds = secondsSince(brushing);
+
+    // only chunks on screen written since they were last drawn are reduced, then one lookup per pixel.
+    // at reduced quality that is a pixel per 2x2 block
+    LARGE_INTEGER rendering;
+    QueryPerformanceCounter(&rendering);
+    bool reduced = governorReduced(&governor);
+    camera_t view = camera;
+    int viewWidth = clientWidth, viewHeight = clientHeight;
+    if (reduced) {
+        view.scale *= 2;
+        viewWidth = (clientWidth + 1) / 2;
+        viewHeight = (clientHeight + 1) / 2;
     }
+    mipUpdateView(&mip, &world, view, viewWidth, viewHeight);
+    GdiFlush();
+    mipRender(&mip, &world, view, framePixels, viewWidth, viewHeight,
+              RGB(BACKGROUND_COLOR.rgbtRed, BACKGROUND_COLOR.rgbtGreen, BACKGROUND_COLOR.rgbtBlue));
+    if (reduced) Upscale(framePixels, clientWidth, clientHeight);
+    double renderSeconds = secondsSince(rendering);
+    governorRendered(&governor, reduced, renderSeconds);
+
+    // the overlay goes on after the render is timed, so it doesn't show up in what it shows
+    statsFrame(&stats, &world, substeps, stepSeconds, brushSeconds, renderSeconds, elapsed);
+    if (hudMode) statsDraw(&stats, framePixels, clientWidth, clientHeight, 8, 8);
 }
@@ -0,0 +1,70 @@
+#include "margolus.h"
+
+// a block's cells, in the order of the bits of its index
+enum { TOP_LEFT, TOP_RIGHT, BOTTOM_LEFT, BOTTOM_RIGHT };
+
+// grains a block moves, each from a filled cell into an empty one
+typedef struct block_move {
+    uint8_t count;
+    uint8_t from[2];
+    uint8_t to[2];
+} block_move_t;
+
+// moves of a block, by index top left | top right << 1 | bottom left << 2 |
+// bottom right << 3 | random bit << 4. a grain with an empty cell under it falls into
+// it, one on top of another slides down beside it only on the random bit
+static const block_move_t MOVES[32] = {
+    [0x01] = { 1, { TOP_LEFT }, { BOTTOM_LEFT } },
+    [0x02] = { 1, { TOP_RIGHT }, { BOTTOM_RIGHT } },
+    [0x03] = { 2, { TOP_LEFT, TOP_RIGHT }, { BOTTOM_LEFT, BOTTOM_RIGHT } },
+    [0x06] = { 1, { TOP_RIGHT }, { BOTTOM_RIGHT } },
+    [0x07] = { 1, { TOP_RIGHT }, { BOTTOM_RIGHT } },
+    [0x09] = { 1, { TOP_LEFT }, { BOTTOM_LEFT } },
+    [0x0B] = { 1, { TOP_LEFT }, { BOTTOM_LEFT } },
+    [0x11] = { 1, { TOP_LEFT }, { BOTTOM_LEFT } },
+    [0x12] = { 1, { TOP_RIGHT }, { BOTTOM_RIGHT } },
+    [0x13] = { 2, { TOP_LEFT, TOP_RIGHT }, { BOTTOM_LEFT, BOTTOM_RIGHT } },
+    [0x15] = { 1, { TOP_LEFT }, { BOTTOM_RIGHT } },
+    [0x16] = { 1, { TOP_RIGHT }, { BOTTOM_RIGHT } },
+    [0x17] = { 1, { TOP_RIGHT }, { BOTTOM_RIGHT } },
+    [0x19] = { 1, { TOP_LEFT }, { BOTTOM_LEFT } },
+    [0x1A] = { 1, { TOP_RIGHT }, { BOTTOM_LEFT } },
+    [0x1B] = { 1, { TOP_LEFT }, { BOTTOM_LEFT } },
+};
+
+// blocks whose move depends on the random bit, a grain on a grain beside an empty cell
+static const int RANDOM_BLOCKS = 1 << 5 | 1 << 10;
+
+int UpdateGridMargolus(world_t* w) {
+    int offset = w->step & 1;
+    // nothing above the highest grain can change
+    int top = 0;
+    if (w->trackSurface) {
+        top = w->height;
+        for (int j = 0; j < w->width; j++) {
+            if (w->surface[j] < top) top = w->surface[j];
+        }
+    }
+    int first = top - ((top - offset) & 1);
+    if (first < 0) first += 2;
+
+    // a row of blocks at a time, so the cells moved are near the ones just read
+    int moved = 0;
+    for (int y = first; y + 1 < w->height; y += 2) {
+        const particle_t* upper = w->cells + cellIndex(w, y, 0);
+        const particle_t* lower = upper + w->stride;
+        for (int x = offset; x + 1 < w->width; x += 2) {
+            int index = upper[x].e | upper[x + 1].e << 1 | lower[x].e << 2 | lower[x + 1].e << 3;
+            if ((1 << index) & RANDOM_BLOCKS) index |= (cellRandom(w, y, x) & 1) << 4;
+            const block_move_t* m = &MOVES[index];
+            for (int k = 0; k < m->count; k++) {
+                moveGrain(w, y + (m->from[k] >> 1), x + (m->from[k] & 1), y + (m->to[k] >> 1), x + (m->to[k] & 1));
+            }
+            moved += m->count;
+        }
+    }
+
+    w->step++;
+    checkSurface(w);
+    return moved;
+}
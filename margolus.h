@@ -0,0 +1,18 @@
+#ifndef SANDSIM_MARGOLUS_H
+#define SANDSIM_MARGOLUS_H
+
+#include "sim.h"
+
+// a step mode in place of the classic rule. the world is cut into 2x2 blocks, shifted a
+// cell down and right on every other update, and each block moves its own grains by a
+// table looked up with which of its four cells are filled and a random bit. no block
+// reads or writes another's cells, so blocks can be visited in any order or at once.
+//
+// a grain falls a cell per update, with no speeding up, and on the random bit slides
+// off a grain under it into the empty cell beside that. blocks sticking out of the
+// world are left alone that update
+
+// advance one update by the block rule, returns the number of grains that moved
+int UpdateGridMargolus(world_t* w);
+
+#endif
@@ -0,0 +1,242 @@
+#include "mip.h"
+
+#include <stdlib.h>
+
+void mipInit(mip_t* m, const world_t* w) {
+    m->width = w->width;
+    m->height = w->height;
+    m->levels = 0;
+    while ((w->width - 1) >> m->levels || (w->height - 1) >> m->levels) {
+        m->levels++;
+    }
+    m->level = calloc(m->levels + 1, sizeof(mip_level_t));
+    m->level[0] = (mip_level_t) { w->width, w->height, NULL };
+    for (int k = 1; k <= m->levels; k++) {
+        mip_level_t* l = &m->level[k];
+        l->width = ((w->width - 1) >> k) + 1;
+        l->height = ((w->height - 1) >> k) + 1;
+        l->texels = calloc((size_t) l->width * l->height, sizeof(mip_texel_t));
+    }
+    m->dirty = malloc((size_t) w->chunksX * w->chunksY * sizeof(int));
+    // every chunk has been stamped at least once, so the first update builds it all
+    m->reduced = calloc((size_t) w->chunksX * w->chunksY, sizeof(uint32_t));
+}
+
+void mipFree(mip_t* m) {
+    for (int k = 1; k <= m->levels; k++) {
+        free(m->level[k].texels);
+    }
+    free(m->level);
+    free(m->dirty);
+    free(m->reduced);
+    m->level = NULL;
+    m->dirty = NULL;
+    m->reduced = NULL;
+}
+
+// running totals of filled cells and their color channels
+typedef struct mix {
+    uint32_t count;
+    uint64_t r;
+    uint64_t g;
+    uint64_t b;
+} mix_t;
+
+static inline void mixAdd(mix_t* mix, COLORREF c, uint32_t count) {
+    mix->count += count;
+    mix->r += (uint64_t) (c & 0xFF) * count;
+    mix->g += (uint64_t) ((c >> 8) & 0xFF) * count;
+    mix->b += (uint64_t) ((c >> 16) & 0xFF) * count;
+}
+
+static inline mip_texel_t mixTexel(const mix_t* mix) {
+    if (!mix->count) return (mip_texel_t) { 0, 0 };
+    // one divide instead of three
+    double inv = 1.0 / mix->count;
+    return (mip_texel_t) {
+        mix->count, RGB((int) (mix->r * inv + 0.5), (int) (mix->g * inv + 0.5), (int) (mix->b * inv + 0.5))
+    };
+}
+
+// 1/n in 16 bit fixed point for the at most four cells under a level 1 texel,
+// exact for every sum of four 8 bit channels
+static const uint32_t QUARTERS[5] = { 0, 65536, 32768, 21846, 16384 };
+
+// level 1 texels [tx0, tx1) x [ty0, ty1) from the cells under them
+static void reduceCells(mip_t* m, const world_t* w, int tx0, int ty0, int tx1, int ty1) {
+    mip_level_t* l = &m->level[1];
+    for (int ty = ty0; ty < ty1; ty++) {
+        int rows = 2 * ty + 2 <= w->height ? 2 : 1;
+        const particle_t* top = &w->cells[cellIndex(w, 2 * ty, 0)];
+        for (int tx = tx0; tx < tx1; tx++) {
+            int columns = 2 * tx + 2 <= w->width ? 2 : 1;
+            uint32_t count = 0, r = 0, g = 0, b = 0;
+            for (int y = 0; y < rows; y++) {
+                const particle_t* p = top + y * w->stride + 2 * tx;
+                for (int x = 0; x < columns; x++) {
+                    if (!p[x].e) continue;
+                    count++;
+                    r += p[x].c & 0xFF;
+                    g += (p[x].c >> 8) & 0xFF;
+                    b += (p[x].c >> 16) & 0xFF;
+                }
+            }
+            uint32_t half = count / 2, scale = QUARTERS[count];
+            l->texels[ty * l->width + tx] = (mip_texel_t) {
+                count, RGB((r + half) * scale >> 16, (g + half) * scale >> 16, (b + half) * scale >> 16)
+            };
+        }
+    }
+}
+
+// level k texels [tx0, tx1) x [ty0, ty1) from the level below
+static void reduceTexels(mip_t* m, int k, int tx0, int ty0, int tx1, int ty1) {
+    mip_level_t* l = &m->level[k];
+    const mip_level_t* below = &m->level[k - 1];
+    for (int ty = ty0; ty < ty1; ty++) {
+        int y1 = 2 * ty + 2 < below->height ? 2 * ty + 2 : below->height;
+        for (int tx = tx0; tx < tx1; tx++) {
+            int x1 = 2 * tx + 2 < below->width ? 2 * tx + 2 : below->width;
+            mix_t mix = { 0 };
+            for (int y = 2 * ty; y < y1; y++) {
+                for (int x = 2 * tx; x < x1; x++) {
+                    const mip_texel_t* t = &below->texels[y * below->width + x];
+                    if (t->count) mixAdd(&mix, t->color, t->count);
+                }
+            }
+            l->texels[ty * l->width + tx] = mixTexel(&mix);
+        }
+    }
+}
+
+// chunks [cx0, cx1) x [cy0, cy1) that were written since they were last reduced
+static void reduceChunks(mip_t* m, world_t* w, int cx0, int cy0, int cx1, int cy1) {
+    int count = 0;
+    for (int cy = cy0; cy < cy1; cy++) {
+        for (int cx = cx0; cx < cx1; cx++) {
+            int c = cy * w->chunksX + cx;
+            if (w->chunkStamp[c] > m->reduced[c]) m->dirty[count++] = c;
+        }
+    }
+    if (!count) return;
+    uint32_t epoch = nextEpoch(w);
+    for (int d = 0; d < count; d++) {
+        m->reduced[m->dirty[d]] = epoch;
+    }
+
+    // a level at a time, a texel above chunk size is reduced once per dirty chunk under it
+    for (int k = 1; k <= m->levels; k++) {
+        for (int d = 0; d < count; d++) {
+            int x0, y0, x1, y1;
+            chunkBounds(w->width, w->height, m->dirty[d], &x0, &y0, &x1, &y1);
+            int tx0 = x0 >> k, ty0 = y0 >> k;
+            int tx1 = ((x1 - 1) >> k) + 1, ty1 = ((y1 - 1) >> k) + 1;
+            if (k == 1) {
+                reduceCells(m, w, tx0, ty0, tx1, ty1);
+            } else {
+                reduceTexels(m, k, tx0, ty0, tx1, ty1);
+            }
+        }
+    }
+}
+
+void mipUpdate(mip_t* m, world_t* w) {
+    reduceChunks(m, w, 0, 0, w->chunksX, w->chunksY);
+}
+
+// the coarsest level with texels no larger than a pixel
+static int levelFor(const mip_t* m, double scale) {
+    int k = 0;
+    while (k < m->levels && (double) (2 << k) <= scale) {
+        k++;
+    }
+    return k;
+}
+
+void mipUpdateView(mip_t* m, world_t* w, camera_t camera, int pixelWidth, int pixelHeight) {
+    int k = levelFor(m, camera.scale);
+    int x0, y0, x1, y1;
+    // zoomed in far enough to read the cells themselves
+    if (k == 0 || !cameraVisible(&camera, pixelWidth, pixelHeight, w->width, w->height, &x0, &y0, &x1, &y1)) return;
+
+    // whole texels of the level drawn from, a texel at the edge of the screen may reach off it
+    x0 = x0 >> k << k;
+    y0 = y0 >> k << k;
+    x1 = (((x1 - 1) >> k) + 1) << k;
+    y1 = (((y1 - 1) >> k) + 1) << k;
+    if (x1 > w->width) x1 = w->width;
+    if (y1 > w->height) y1 = w->height;
+    reduceChunks(m, w, x0 >> CHUNK_SHIFT, y0 >> CHUNK_SHIFT, ((x1 - 1) >> CHUNK_SHIFT) + 1, ((y1 - 1) >> CHUNK_SHIFT) + 1);
+}
+
+static inline uint32_t pixelOf(COLORREF c) {
+    return (c & 0xFF) << 16 | (c & 0xFF00) | (c >> 16 & 0xFF);
+}
+
+// cells texel t of level k covers along an axis of size cells
+static inline int texelSpan(int t, int k, int size) {
+    int start = t << k;
+    return start + (1 << k) < size ? 1 << k : size - start;
+}
+
+// cell a pixel's center falls on along one axis, -1 off the world
+static int cellUnder(double origin, double scale, int pixel, int size) {
+    double p = origin + (pixel + 0.5) * scale;
+    if (p < 0 || p >= size) return -1;
+    return (int) p;
+}
+
+void mipRender(const mip_t* m, const world_t* w, camera_t camera, uint32_t* pixels, int pixelWidth, int pixelHeight,
+               COLORREF background) {
+    int k = levelFor(m, camera.scale);
+    const mip_level_t* l = &m->level[k];
+    uint32_t backgroundPixel = pixelOf(background);
+    uint64_t backR = background & 0xFF, backG = (background >> 8) & 0xFF, backB = (background >> 16) & 0xFF;
+
+    // texel column under every pixel column and the cells it spans, so the inner loop is lookups
+    int* columns = malloc(pixelWidth * 2 * sizeof(int));
+    int* spans = columns + pixelWidth;
+    for (int px = 0; px < pixelWidth; px++) {
+        int x = cellUnder(camera.x, camera.scale, px, w->width);
+        columns[px] = x < 0 ? -1 : x >> k;
+        spans[px] = x < 0 ? 0 : texelSpan(x >> k, k, w->width);
+    }
+
+    for (int py = 0; py < pixelHeight; py++) {
+        uint32_t* out = pixels + (size_t) py * pixelWidth;
+        int y = cellUnder(camera.y, camera.scale, py, w->height);
+        if (y < 0) {
+            for (int px = 0; px < pixelWidth; px++) out[px] = backgroundPixel;
+            continue;
+        }
+        int ty = y >> k;
+
+        if (k == 0) {
+            const particle_t* row = &w->cells[cellIndex(w, y, 0)];
+            for (int px = 0; px < pixelWidth; px++) {
+                int x = columns[px];
+                out[px] = x >= 0 && row[x].e ? pixelOf(row[x].c) : backgroundPixel;
+            }
+            continue;
+        }
+
+        const mip_texel_t* row = &l->texels[(size_t) ty * l->width];
+        uint64_t spanY = texelSpan(ty, k, w->height);
+        for (int px = 0; px < pixelWidth; px++) {
+            int tx = columns[px];
+            if (tx < 0 || !row[tx].count) {
+                out[px] = backgroundPixel;
+                continue;
+            }
+            // the mean color, faded into the background by the share of empty cells
+            uint64_t area = spans[px] * spanY;
+            uint64_t count = row[tx].count;
+            COLORREF c = row[tx].color;
+            uint64_t r = (backR * (area - count) + (c & 0xFF) * count) / area;
+            uint64_t g = (backG * (area - count) + ((c >> 8) & 0xFF) * count) / area;
+            uint64_t b = (backB * (area - count) + ((c >> 16) & 0xFF) * count) / area;
+            out[px] = (uint32_t) (r << 16 | g << 8 | b);
+        }
+    }
+    free(columns);
+}
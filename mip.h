@@ -0,0 +1,52 @@
+#ifndef SANDSIM_MIP_H
+#define SANDSIM_MIP_H
+
+#include "camera.h"
+#include "sim.h"
+
+// a pyramid of 2x2 reductions of a world, so a zoomed out view can read one texel
+// per screen pixel instead of every cell under it. level 0 is the world itself,
+// level k has a texel per 2^k x 2^k block of cells holding how many of them are
+// filled and their mean color. a chunk is only reduced again once it has been
+// written and is wanted, either by a whole update or because it is on screen
+
+typedef struct mip_texel {
+    // filled cells under the texel
+    uint32_t count;
+    // their mean color
+    COLORREF color;
+} mip_texel_t;
+
+typedef struct mip_level {
+    int width;
+    int height;
+    mip_texel_t* texels;
+} mip_level_t;
+
+typedef struct mip {
+    // levels above 0, level[k] for k in [1, levels]
+    int levels;
+    mip_level_t* level;
+    // world size it was built for
+    int width;
+    int height;
+    // epoch each chunk was last reduced in
+    uint32_t* reduced;
+    // scratch list of chunks to reduce
+    int* dirty;
+} mip_t;
+
+void mipInit(mip_t* m, const world_t* w);
+void mipFree(mip_t* m);
+// reduce every chunk written since it was last reduced. uses up an epoch of w
+void mipUpdate(mip_t* m, world_t* w);
+// the same for only the chunks mipRender() would read for this camera and screen size
+void mipUpdateView(mip_t* m, world_t* w, camera_t camera, int pixelWidth, int pixelHeight);
+
+// paint pixels (0x00RRGGBB, top row first) from the level whose texels are closest
+// to a pixel in size. a texel is its mean color faded into background by how empty
+// it is. costs a fixed amount per pixel however large the world
+void mipRender(const mip_t* m, const world_t* w, camera_t camera, uint32_t* pixels, int pixelWidth, int pixelHeight,
+               COLORREF background);
+
+#endif
@@ -0,0 +1,139 @@
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "net.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+typedef SOCKET raw_socket_t;
+#define closeSocket closesocket
+#else
+typedef int raw_socket_t;
+#define closeSocket close
+#define INVALID_SOCKET (-1)
+#endif
+
+static void netStartup() {
+    static bool started = false;
+    if (started) return;
+    started = true;
+#ifdef _WIN32
+    WSADATA data;
+    WSAStartup(MAKEWORD(2, 2), &data);
+#else
+    // a spectator going away shows up as a failed send, not a signal
+    signal(SIGPIPE, SIG_IGN);
+#endif
+}
+
+static net_socket_t wrap(raw_socket_t s) {
+    return s == INVALID_SOCKET ? NET_INVALID : (net_socket_t) s;
+}
+
+net_socket_t netListen(const char* address, int port) {
+    netStartup();
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons((unsigned short) port);
+    if (address) {
+        struct addrinfo hints, *found;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        if (getaddrinfo(address, NULL, &hints, &found) != 0) return NET_INVALID;
+        addr.sin_addr = ((struct sockaddr_in*) found->ai_addr)->sin_addr;
+        freeaddrinfo(found);
+    }
+
+    raw_socket_t s = socket(AF_INET, SOCK_STREAM, 0);
+    if (s == INVALID_SOCKET) return NET_INVALID;
+    int yes = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char*) &yes, sizeof(yes));
+    if (bind(s, (struct sockaddr*) &addr, sizeof(addr)) != 0 || listen(s, 8) != 0) {
+        closeSocket(s);
+        return NET_INVALID;
+    }
+    return wrap(s);
+}
+
+int netLocalPort(net_socket_t s) {
+    struct sockaddr_in addr;
+    socklen_t size = sizeof(addr);
+    if (s == NET_INVALID || getsockname((raw_socket_t) s, (struct sockaddr*) &addr, &size) != 0) return 0;
+    return ntohs(addr.sin_port);
+}
+
+net_socket_t netAccept(net_socket_t listener, int timeoutMs) {
+    raw_socket_t l = (raw_socket_t) listener;
+    fd_set ready;
+    FD_ZERO(&ready);
+    FD_SET(l, &ready);
+    struct timeval timeout = { timeoutMs / 1000, (timeoutMs % 1000) * 1000 };
+    if (select((int) l + 1, &ready, NULL, NULL, &timeout) <= 0) return NET_INVALID;
+
+    raw_socket_t s = accept(l, NULL, NULL);
+    if (s != INVALID_SOCKET) {
+        int yes = 1;
+        setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char*) &yes, sizeof(yes));
+    }
+    return wrap(s);
+}
+
+net_socket_t netConnect(const char* host, int port) {
+    netStartup();
+    char service[16];
+    snprintf(service, sizeof(service), "%d", port);
+    struct addrinfo hints, *found;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, service, &hints, &found) != 0) return NET_INVALID;
+
+    raw_socket_t s = socket(found->ai_family, found->ai_socktype, found->ai_protocol);
+    if (s != INVALID_SOCKET && connect(s, found->ai_addr, (int) found->ai_addrlen) != 0) {
+        closeSocket(s);
+        s = INVALID_SOCKET;
+    }
+    freeaddrinfo(found);
+    return wrap(s);
+}
+
+bool netSend(net_socket_t s, const void* data, size_t size) {
+    const char* p = data;
+    while (size > 0) {
+        int sent = send((raw_socket_t) s, p, size > (1 << 30) ? (1 << 30) : (int) size, 0);
+        if (sent <= 0) return false;
+        p += sent;
+        size -= sent;
+    }
+    return true;
+}
+
+bool netRecv(net_socket_t s, void* data, size_t size) {
+    char* p = data;
+    while (size > 0) {
+        int got = recv((raw_socket_t) s, p, size > (1 << 30) ? (1 << 30) : (int) size, 0);
+        if (got <= 0) return false;
+        p += got;
+        size -= got;
+    }
+    return true;
+}
+
+void netClose(net_socket_t s) {
+    if (s != NET_INVALID) closeSocket((raw_socket_t) s);
+}
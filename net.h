@@ -0,0 +1,27 @@
+#ifndef SANDSIM_NET_H
+#define SANDSIM_NET_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// thin blocking tcp helpers over winsock and bsd sockets. sockets are plain
+// handles, NET_INVALID when there is none
+typedef intptr_t net_socket_t;
+#define NET_INVALID ((net_socket_t) -1)
+
+// listen on port at address, or on the loopback interface only when address is NULL.
+// other machines can only connect when asked for with an address such as "0.0.0.0".
+// port 0 takes any free port
+net_socket_t netListen(const char* address, int port);
+// the port a socket is bound to, 0 if unknown
+int netLocalPort(net_socket_t s);
+// accepts a pending connection, waiting at most timeoutMs. NET_INVALID if none came
+net_socket_t netAccept(net_socket_t listener, int timeoutMs);
+net_socket_t netConnect(const char* host, int port);
+bool netSend(net_socket_t s, const void* data, size_t size);
+// reads exactly size bytes, false on error or a closed connection
+bool netRecv(net_socket_t s, void* data, size_t size);
+void netClose(net_socket_t s);
+
+#endif
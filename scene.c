@@ -0,0 +1,96 @@
+#include "scene.h"
+
+#include <string.h>
+
+// random numbers for scene building, separate from the world's per cell random so
+// building a scene never shifts how it then plays out
+static uint32_t random32(uint32_t* state) {
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+static void fill(world_t* w, int y, int x) {
+    interpolateColor(w);
+    set(w, y, x, (particle_t) { w->currentColor, true, false, 0 });
+}
+
+// fill each cell of rows [y0, y1) and columns [x0, x1) with the given chance in percent
+static void noiseRect(world_t* w, int y0, int y1, int x0, int x1, unsigned percent, uint32_t* state) {
+    for (int i = y0; i < y1; i++) {
+        for (int j = x0; j < x1; j++) {
+            if (random32(state) % 100 < percent) fill(w, i, j);
+        }
+    }
+}
+
+static void nothing(world_t* w) {
+    (void) w;
+}
+
+// a stream out of the top middle, as wide as a 64th of the world
+static void pourFeed(world_t* w) {
+    int radius = w->width / 128;
+    pour(w, radius < 4 ? 4 : radius);
+}
+
+// a solid block as tall as half the world over empty space
+static void tower(world_t* w) {
+    for (int i = 0; i < w->height / 2; i++) {
+        for (int j = w->width / 3; j < 2 * w->width / 3; j++) fill(w, i, j);
+    }
+}
+
+// a third of the top half filled at random
+static void noise(world_t* w) {
+    uint32_t state = w->seed;
+    noiseRect(w, 0, w->height / 2, 0, w->width, 30, &state);
+}
+
+// everything below half height at rest, and a little rain into one spot of it
+static void settled(world_t* w) {
+    for (int i = w->height / 2; i < w->height; i++) {
+        for (int j = 0; j < w->width; j++) fill(w, i, j);
+    }
+}
+
+static void settledFeed(world_t* w) {
+    uint32_t state = w->seed ^ w->step * 0x9E3779B1u;
+    int span = w->width / 32 + 1;
+    int x0 = w->width / 4;
+    for (int k = 0; k < 4; k++) {
+        int j = x0 + random32(&state) % span;
+        if (j < w->width && !at(w, 0, j).e) fill(w, 0, j);
+    }
+}
+
+// nearly every cell filled over an empty eighth of the world, so the whole grid moves
+static void avalanche(world_t* w) {
+    uint32_t state = w->seed;
+    noiseRect(w, 0, w->height - w->height / 8, 0, w->width, 90, &state);
+}
+
+const scene_type_t SCENE_TYPES[] = {
+    { "pour", "continuous pour into an empty world", nothing, pourFeed },
+    { "tower", "solid block collapsing", tower, NULL },
+    { "noise", "random fill of the top half", noise, NULL },
+    { "settled", "settled world with one active spot", settled, settledFeed },
+    { "avalanche", "whole grid falling at once", avalanche, NULL },
+};
+const int SCENE_TYPE_COUNT = sizeof(SCENE_TYPES) / sizeof(SCENE_TYPES[0]);
+
+const scene_type_t* findScene(const char* name) {
+    for (int i = 0; i < SCENE_TYPE_COUNT; i++) {
+        if (strcmp(SCENE_TYPES[i].name, name) == 0) return &SCENE_TYPES[i];
+    }
+    return NULL;
+}
+
+void sceneCreate(world_t* w, const scene_type_t* scene, int width, int height, uint32_t seed) {
+    worldInit(w, width, height, seed);
+    scene->setup(w);
+}
+
+int sceneStep(world_t* w, const scene_type_t* scene) {
+    if (scene->feed) scene->feed(w);
+    return UpdateGrid(w);
+}
@@ -0,0 +1,28 @@
+#ifndef SANDSIM_SCENE_H
+#define SANDSIM_SCENE_H
+
+#include "sim.h"
+
+// standard workloads for benchmarks. a scene depends only on its size and seed, so
+// the same scene built by two releases is the same world and their timings compare
+
+typedef struct scene_type {
+    const char* name;
+    const char* description;
+    // fills a freshly initialized world
+    void (*setup)(world_t* w);
+    // adds grains before every update, may be NULL
+    void (*feed)(world_t* w);
+} scene_type_t;
+
+extern const scene_type_t SCENE_TYPES[];
+extern const int SCENE_TYPE_COUNT;
+
+// the scene called name, NULL if there is none
+const scene_type_t* findScene(const char* name);
+// initialize w as a width x height world holding the scene
+void sceneCreate(world_t* w, const scene_type_t* scene, int width, int height, uint32_t seed);
+// give the scene its input for the next update, then advance the world by it
+int sceneStep(world_t* w, const scene_type_t* scene);
+
+#endif
@@ -0,0 +1,173 @@
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "share.h"
+#include "thread.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static size_t gridBytes(uint32_t stride, uint32_t height) {
+    return (size_t) stride * (height + 2) * sizeof(particle_t);
+}
+
+// map segment name, creating it bytes long when create is set. a reader maps it read only
+static bool mapSegment(share_t* s, const char* name, bool create) {
+#ifdef _WIN32
+    snprintf(s->name, sizeof(s->name), "Local\\%s", name);
+    if (create) {
+        s->mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+                                        (DWORD) ((uint64_t) s->bytes >> 32), (DWORD) s->bytes, s->name);
+    } else {
+        s->mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, s->name);
+    }
+    if (s->mapping == NULL) return false;
+    void* p = MapViewOfFile(s->mapping, create ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ, 0, 0, create ? s->bytes : 0);
+    if (p == NULL) {
+        CloseHandle(s->mapping);
+        return false;
+    }
+    if (!create) {
+        MEMORY_BASIC_INFORMATION info;
+        VirtualQuery(p, &info, sizeof(info));
+        s->bytes = info.RegionSize;
+    }
+#else
+    snprintf(s->name, sizeof(s->name), "/%s", name);
+    int fd = create ? shm_open(s->name, O_CREAT | O_RDWR | O_TRUNC, 0644) : shm_open(s->name, O_RDONLY, 0);
+    if (fd < 0) return false;
+    if (create && ftruncate(fd, (off_t) s->bytes) != 0) {
+        close(fd);
+        shm_unlink(s->name);
+        return false;
+    }
+    if (!create) {
+        struct stat st;
+        s->bytes = fstat(fd, &st) == 0 ? (size_t) st.st_size : 0;
+        if (s->bytes < sizeof(share_header_t)) {
+            close(fd);
+            return false;
+        }
+    }
+    void* p = mmap(NULL, s->bytes, create ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        if (create) shm_unlink(s->name);
+        return false;
+    }
+#endif
+    s->header = p;
+    return true;
+}
+
+static void unmapSegment(share_t* s) {
+#ifdef _WIN32
+    UnmapViewOfFile(s->header);
+    CloseHandle(s->mapping);
+#else
+    munmap(s->header, s->bytes);
+#endif
+    s->header = NULL;
+}
+
+bool shareOpen(share_t* s, world_t* w, const char* name) {
+    memset(s, 0, sizeof(*s));
+    // cells start on a cache line of their own
+    size_t offset = (sizeof(share_header_t) + 63) & ~(size_t) 63;
+    s->bytes = offset + gridBytes(w->stride, w->height);
+    if (!mapSegment(s, name, true)) return false;
+
+    share_header_t* h = s->header;
+    h->magic = SHARE_MAGIC;
+    h->version = SHARE_VERSION;
+    h->width = w->width;
+    h->height = w->height;
+    h->stride = w->stride;
+    h->cellBytes = sizeof(particle_t);
+    h->cellsOffset = (uint32_t) offset;
+    h->step = w->step;
+    h->sequence = 0;
+
+    particle_t* cells = (particle_t*) ((char*) h + offset);
+    memcpy(cells, w->cells, gridBytes(w->stride, w->height));
+    free(w->cells);
+    w->cells = cells;
+    s->world = w;
+    return true;
+}
+
+void shareClose(share_t* s) {
+    world_t* w = s->world;
+    assert(!(s->header->sequence & 1));
+    particle_t* cells = malloc(gridBytes(w->stride, w->height));
+    memcpy(cells, w->cells, gridBytes(w->stride, w->height));
+    w->cells = cells;
+    unmapSegment(s);
+#ifndef _WIN32
+    // readers still attached keep their mapping, the name goes now
+    shm_unlink(s->name);
+#endif
+    s->world = NULL;
+}
+
+void shareBegin(share_t* s) {
+    assert(!(s->header->sequence & 1));
+    atomicStore(&s->header->sequence, s->header->sequence + 1);
+    // no cell write may be seen before the sequence turns odd
+    atomicFence();
+}
+
+void shareEnd(share_t* s) {
+    assert(s->header->sequence & 1);
+    s->header->step = s->world->step;
+    atomicStore(&s->header->sequence, s->header->sequence + 1);
+}
+
+bool shareAttach(share_t* s, const char* name) {
+    memset(s, 0, sizeof(*s));
+    if (!mapSegment(s, name, false)) return false;
+    const share_header_t* h = s->header;
+    bool valid = h->magic == SHARE_MAGIC && h->version == SHARE_VERSION && h->cellBytes == sizeof(particle_t)
+                 && h->stride == h->width + 2 && s->bytes >= h->cellsOffset + gridBytes(h->stride, h->height);
+    if (!valid) unmapSegment(s);
+    return valid;
+}
+
+void shareDetach(share_t* s) {
+    unmapSegment(s);
+}
+
+int shareReadBegin(const share_t* s) {
+    int* sequence = (int*) &s->header->sequence;
+    int v;
+    while ((v = atomicLoad(sequence)) & 1) {
+        threadYield();
+    }
+    return v;
+}
+
+bool shareReadValid(const share_t* s, int sequence) {
+    // every cell read has to be done before the sequence is looked at again
+    atomicFence();
+    return atomicLoad((int*) &s->header->sequence) == sequence;
+}
+
+bool shareSnapshot(const share_t* s, particle_t* cells, uint32_t* step, int tries) {
+    const share_header_t* h = s->header;
+    for (int t = 0; t < tries; t++) {
+        int sequence = shareReadBegin(s);
+        uint32_t at = h->step;
+        memcpy(cells, shareCells(s), gridBytes(h->stride, h->height));
+        if (shareReadValid(s, sequence)) {
+            if (step) *step = at;
+            return true;
+        }
+    }
+    return false;
+}
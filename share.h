@@ -0,0 +1,71 @@
+#ifndef SANDSIM_SHARE_H
+#define SANDSIM_SHARE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "sim.h"
+
+// a world's cells moved into a named shared memory segment, so other processes can map
+// the live grid and read it where it lies instead of having it copied out to them.
+// the segment is a share_header_t followed at cellsOffset by the cells, border included,
+// row by row as particle_t, all in the machine's byte order.
+//
+// the header's sequence is a seqlock. the simulation makes it odd before writing cells
+// and even again after, so a reader takes what it needs between shareReadBegin() and
+// shareReadValid() and tries again if the cells changed under it
+#define SHARE_MAGIC 0x52485353u
+#define SHARE_VERSION 1
+
+typedef struct share_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    // cells per row, border included
+    uint32_t stride;
+    uint32_t cellBytes;
+    uint32_t cellsOffset;
+    // the world's update count as of the last shareEnd()
+    uint32_t step;
+    // odd while the cells are being written
+    int sequence;
+} share_header_t;
+
+// one end of a segment, the simulation's or a reader's
+typedef struct share {
+    share_header_t* header;
+    size_t bytes;
+    // the world whose cells live in the segment, NULL for a reader
+    world_t* world;
+    char name[64];
+#ifdef _WIN32
+    HANDLE mapping;
+#endif
+} share_t;
+
+// create segment name and move w's cells into it. false if it can't be created
+bool shareOpen(share_t* s, world_t* w, const char* name);
+// move the cells back out into w's own memory and remove the segment.
+// must be called before the world is freed
+void shareClose(share_t* s);
+// bracket writes to the world's cells, updates and edits alike
+void shareBegin(share_t* s);
+void shareEnd(share_t* s);
+
+// map segment name read only. false if there is none or it isn't a world
+bool shareAttach(share_t* s, const char* name);
+void shareDetach(share_t* s);
+// the mapped cells, cell (y, x) at cellIndex() of a world the header's size
+static inline const particle_t* shareCells(const share_t* s) {
+    return (const particle_t*) ((const char*) s->header + s->header->cellsOffset);
+}
+// sequence to read under, once no write is in progress
+int shareReadBegin(const share_t* s);
+// true if nothing was written since shareReadBegin() returned sequence
+bool shareReadValid(const share_t* s, int sequence);
+// copy the cells, border included, into cells as they were between two writes.
+// gives up after tries attempts that all overlapped a write
+bool shareSnapshot(const share_t* s, particle_t* cells, uint32_t* step, int tries);
+
+#endif
@@ -0,0 +1,90 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "share.h"
+#include "thread.h"
+
+// reads a world another process publishes with shareOpen(): a copied snapshot of the
+// grid for each new update, and the fill of every column counted in place without one
+static void usage() {
+    fprintf(stderr, "usage: sandsim_sharepeek [--name NAME] [--updates N]\n");
+    exit(1);
+}
+
+int main(int argc, char** argv) {
+    const char* name = "sandsim";
+    int updates = 10;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--name") == 0) {
+            name = argv[++i];
+        } else if (i + 1 < argc && strcmp(argv[i], "--updates") == 0) {
+            updates = atoi(argv[++i]);
+        } else {
+            usage();
+        }
+    }
+
+    share_t s;
+    if (!shareAttach(&s, name)) {
+        fprintf(stderr, "no world shared as %s\n", name);
+        return 1;
+    }
+    const share_header_t* h = s.header;
+    int width = (int) h->width, height = (int) h->height, stride = (int) h->stride;
+    printf("world %dx%d shared as %s\n", width, height, name);
+
+    particle_t* cells = malloc((size_t) stride * (height + 2) * sizeof(particle_t));
+    int* fill = malloc(width * sizeof(int));
+    uint32_t last = h->step - 1;
+    int seen = 0, retries = 0;
+    time_t idle = time(NULL);
+    while (seen < updates) {
+        if (h->step == last) {
+            // the simulation is paused or gone
+            if (time(NULL) - idle > 5) break;
+            threadYield();
+            continue;
+        }
+
+        uint32_t step;
+        if (!shareSnapshot(&s, cells, &step, 100)) {
+            retries++;
+            continue;
+        }
+        int grains = 0;
+        for (int i = 0; i < height; i++) {
+            for (int j = 0; j < width; j++) grains += cells[(i + 1) * stride + j + 1].e;
+        }
+
+        // the same kind of question answered straight from the mapping, retried until
+        // no update overlapped the read
+        int sequence;
+        do {
+            sequence = shareReadBegin(&s);
+            const particle_t* live = shareCells(&s);
+            for (int j = 0; j < width; j++) {
+                fill[j] = 0;
+                for (int i = 0; i < height; i++) fill[j] += live[(i + 1) * stride + j + 1].e;
+            }
+            retries++;
+        } while (!shareReadValid(&s, sequence));
+        retries--;
+        int fullest = 0;
+        for (int j = 1; j < width; j++) {
+            if (fill[j] > fill[fullest]) fullest = j;
+        }
+
+        printf("update %u: %d grains, fullest column %d with %d\n", step, grains, fullest, fill[fullest]);
+        last = step;
+        idle = time(NULL);
+        seen++;
+    }
+    printf("%d updates read, %d reads retried\n", seen, retries);
+
+    free(cells);
+    free(fill);
+    shareDetach(&s);
+    return seen > 0 ? 0 : 1;
+}
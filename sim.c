@@ -0,0 +1,1057 @@
+#include "sim.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// color change per update for new worlds
+float COLOR_PERCENT = 0.001;
+// fall speed gained per update, in 1/16 cells
+int GRAVITY = 4;
+// terminal fall speed, in cells per update
+int MAX_FALL = 64;
+
+// 3 color gradient options
+/*
+RGBTRIPLE COLOR_1 = { 242, 145, 135 };
+RGBTRIPLE COLOR_2 = { 139, 32, 211 };
+RGBTRIPLE COLOR_3 = { 0, 160, 253 };
+RGBTRIPLE COLOR_1 = { 135, 145, 242 };
+RGBTRIPLE COLOR_2 = { 211, 32, 139 };
+RGBTRIPLE COLOR_3 = { 253, 160, 0 };
+*/
+RGBTRIPLE COLOR_1 = { 106, 86, 75 };
+RGBTRIPLE COLOR_2 = { 142, 131, 87 };
+RGBTRIPLE COLOR_3 = { 156, 196, 72 };
+
+// def of empty grid
+const particle_t EMPTY = { RGB(0, 0, 0), false, false, 0 };
+// def of the border around the grid, filled and never moves
+const particle_t WALL = { RGB(0, 0, 0), true, true, 0 };
+
+static int bitScanForward(uint64_t v) {
+#ifdef _MSC_VER
+    unsigned long i;
+    _BitScanForward64(&i, v);
+    return (int) i;
+#else
+    return __builtin_ctzll(v);
+#endif
+}
+
+static int popCount(uint64_t v) {
+#ifdef _MSC_VER
+    return (int) __popcnt64(v);
+#else
+    return __builtin_popcountll(v);
+#endif
+}
+
+// add delta grains to chunk (cy, cx) and to every node of the chunk tree covering it
+static void addToChunk(world_t* w, int cy, int cx, int delta) {
+    w->chunkGrains[cy * w->chunksX + cx] += delta;
+    for (int i = cy + 1; i <= w->chunksY; i += i & -i) {
+        int* row = w->chunkTree + (i - 1) * w->chunksX - 1;
+        for (int j = cx + 1; j <= w->chunksX; j += j & -j) row[j] += delta;
+    }
+}
+
+// grains in chunks [0, cy) x [0, cx)
+static int chunkPrefix(const world_t* w, int cy, int cx) {
+    int sum = 0;
+    for (int i = cy; i > 0; i -= i & -i) {
+        const int* row = w->chunkTree + (i - 1) * w->chunksX - 1;
+        for (int j = cx; j > 0; j -= j & -j) sum += row[j];
+    }
+    return sum;
+}
+
+static int firstFilledBelow(const world_t* w, int y, int x, int limit);
+
+static void setOccupied(world_t* w, int y, int x, bool e) {
+    uint64_t* word = &w->occupancy[x * w->columnWords + (y >> 6)];
+    uint64_t bit = (uint64_t) 1 << (y & 63);
+    if (((*word & bit) != 0) != e) addToChunk(w, y >> CHUNK_SHIFT, x >> CHUNK_SHIFT, e ? 1 : -1);
+    *word = e ? (*word | bit) : (*word & ~bit);
+
+    if (!w->trackSurface) return;
+    if (e) {
+        if (y < w->surface[x]) w->surface[x] = y;
+    } else if (y == w->surface[x]) {
+        // the top grain left, the next one down is the new surface
+        w->surface[x] = firstFilledBelow(w, y, x, w->height - 1);
+    }
+}
+
+void worldInit(world_t* w, int width, int height, uint32_t seed) {
+    w->width = width;
+    w->height = height;
+    w->stride = width + 2;
+    w->cells = malloc((size_t) w->stride * (height + 2) * sizeof(particle_t));
+    // one extra bit per column for the floor
+    w->columnWords = (height + 64) / 64;
+    w->occupancy = calloc((size_t) width * w->columnWords, sizeof(uint64_t));
+    w->surface = malloc(width * sizeof(int));
+    w->trackSurface = true;
+    w->chunksX = (width + CHUNK_SIZE - 1) >> CHUNK_SHIFT;
+    w->chunksY = (height + CHUNK_SIZE - 1) >> CHUNK_SHIFT;
+    w->chunkStamp = calloc((size_t) w->chunksX * w->chunksY, sizeof(uint32_t));
+    w->chunkGrains = calloc((size_t) w->chunksX * w->chunksY, sizeof(int));
+    w->chunkTree = calloc((size_t) w->chunksX * w->chunksY, sizeof(int));
+    w->epoch = 1;
+    w->beforeWrite = NULL;
+    w->checkpoint = NULL;
+    w->kernel = selectKernel(w);
+    w->liftAirborne = false;
+    memset(&w->airborne, 0, sizeof(w->airborne));
+    w->worklist = false;
+    w->active = NULL;
+    w->activeWords = (width + 63) / 64;
+    w->activeRow = NULL;
+    w->activeValid = false;
+    w->spanEdges = NULL;
+    w->seed = seed;
+    w->step = 0;
+    w->originY = 0;
+    w->colorRate = COLOR_PERCENT;
+    w->colorPercent = 0.0;
+    w->colorDirection = 1;
+    w->currentColor = RGB(0, 0, 0);
+    worldClear(w);
+}
+
+void worldFree(world_t* w) {
+    free(w->cells);
+    free(w->occupancy);
+    free(w->surface);
+    free(w->chunkStamp);
+    free(w->chunkGrains);
+    free(w->chunkTree);
+    free(w->airborne.y);
+    free(w->airborne.x);
+    free(w->airborne.v);
+    free(w->airborne.distance);
+    free(w->airborne.p);
+    free(w->airborne.cut);
+    memset(&w->airborne, 0, sizeof(w->airborne));
+    free(w->active);
+    free(w->activeRow);
+    free(w->spanEdges);
+    w->active = NULL;
+    w->activeRow = NULL;
+    w->spanEdges = NULL;
+    w->chunkStamp = NULL;
+    w->chunkGrains = NULL;
+    w->chunkTree = NULL;
+    w->cells = NULL;
+    w->occupancy = NULL;
+    w->surface = NULL;
+}
+
+void worldClear(world_t* w) {
+    for (int c = 0; c < w->chunksX * w->chunksY; c++) {
+        if (w->chunkStamp[c] != w->epoch) stampChunk(w, c);
+    }
+    for (int i = -1; i <= w->height; i++) {
+        for (int j = -1; j <= w->width; j++) {
+            bool border = i < 0 || i == w->height || j < 0 || j == w->width;
+            w->cells[cellIndex(w, i, j)] = border ? WALL : EMPTY;
+        }
+    }
+    memset(w->occupancy, 0, (size_t) w->width * w->columnWords * sizeof(uint64_t));
+    memset(w->chunkGrains, 0, (size_t) w->chunksX * w->chunksY * sizeof(int));
+    memset(w->chunkTree, 0, (size_t) w->chunksX * w->chunksY * sizeof(int));
+    for (int j = 0; j < w->width; j++) {
+        // the floor counts as filled, so a search down a column always stops there
+        w->occupancy[j * w->columnWords + (w->height >> 6)] |= (uint64_t) 1 << (w->height & 63);
+        w->surface[j] = w->height;
+    }
+    if (w->active) {
+        memset(w->active, 0, (size_t) w->height * w->activeWords * sizeof(uint64_t));
+        memset(w->activeRow, 0, w->height * sizeof(bool));
+        w->activeValid = true;
+    }
+}
+
+uint32_t nextEpoch(world_t* w) {
+    return w->epoch++;
+}
+
+bool inRange(const world_t* w, int y, int x) {
+    return y >= 0 && y < w->height && x >= 0 && x < w->width;
+}
+
+particle_t at(const world_t* w, int i, int j) {
+    return inRange(w, i, j) ? w->cells[cellIndex(w, i, j)] : EMPTY;
+}
+
+// put grain (y, x) on the list for its next turn
+static inline void markActive(world_t* w, int y, int x) {
+    w->active[y * w->activeWords + (x >> 6)] |= (uint64_t) 1 << (x & 63);
+    w->activeRow[y] = true;
+}
+
+// cell (y, x) was emptied, so the grains that could move into it get a turn. empty
+// cells on the list are passed over
+static inline void wakeAbove(world_t* w, int y, int x) {
+    if (y == 0) return;
+    if (x > 0) markActive(w, y - 1, x - 1);
+    markActive(w, y - 1, x);
+    if (x + 1 < w->width) markActive(w, y - 1, x + 1);
+}
+
+void set(world_t* w, int i, int j, particle_t val) {
+    if (inRange(w, i, j)) {
+        touchChunk(w, i, j);
+        w->cells[cellIndex(w, i, j)] = val;
+        setOccupied(w, i, j, val.e);
+        if (w->active) {
+            if (val.e) {
+                markActive(w, i, j);
+            } else {
+                wakeAbove(w, i, j);
+            }
+        }
+    }
+}
+
+// put columns [x0, x1) of row y on the list, clipped to the world
+static void markSpan(world_t* w, int y, int x0, int x1) {
+    if (x0 < 0) x0 = 0;
+    if (x1 > w->width) x1 = w->width;
+    uint64_t* row = &w->active[y * w->activeWords];
+    for (int x = x0; x < x1;) {
+        int n = 64 - (x & 63) < x1 - x ? 64 - (x & 63) : x1 - x;
+        row[x >> 6] |= (~(uint64_t) 0 >> (64 - n)) << (x & 63);
+        x += n;
+    }
+    w->activeRow[y] = true;
+}
+
+// setSpans(), or paintSpans() when cells is set: then val only says the cells are grains
+static int writeSpans(world_t* w, const span_t* spans, int count, particle_t val, const particle_t* cells) {
+    bool empty = !cells && memcmp(&val, &EMPTY, sizeof(val)) == 0;
+    // where the rows of the current chunk row start or stop being written, going along
+    // the columns, as occupancy bits. xored up from the left they give the rows written
+    // in each column. every one is cleared again as it is read
+    if (!w->spanEdges) w->spanEdges = calloc(w->width + 1, sizeof(uint64_t));
+    uint64_t* edges = w->spanEdges;
+    int changed = 0;
+    for (int i = 0; i < count;) {
+        int cy = spans[i].y >> CHUNK_SHIFT;
+        int lo = w->width, hi = 0;
+        for (; i < count && spans[i].y >> CHUNK_SHIFT == cy; i++) {
+            int y = spans[i].y;
+            int x0 = spans[i].x0 > 0 ? spans[i].x0 : 0;
+            int x1 = spans[i].x1 < w->width ? spans[i].x1 : w->width;
+            const particle_t* spanCells = cells;
+            if (cells && spans[i].x1 > spans[i].x0) cells += spans[i].x1 - spans[i].x0;
+            if (y < 0 || y >= w->height || x0 >= x1) continue;
+            // this span's cells, past what was clipped off its left
+            const particle_t* from = spanCells ? spanCells + (x0 - spans[i].x0) : NULL;
+            for (int cx = x0 >> CHUNK_SHIFT; cx <= (x1 - 1) >> CHUNK_SHIFT; cx++) {
+                int c = cy * w->chunksX + cx;
+                if (w->chunkStamp[c] != w->epoch) stampChunk(w, c);
+            }
+            particle_t* row = &w->cells[cellIndex(w, y, 0)];
+            if (from) {
+                memcpy(row + x0, from, (x1 - x0) * sizeof(particle_t));
+            } else if (empty) {
+                memset(row + x0, 0, (x1 - x0) * sizeof(particle_t));
+            } else {
+                // doubling copies, which go at memcpy() speed
+                row[x0] = val;
+                for (int n = 1; n < x1 - x0; n *= 2) {
+                    memcpy(row + x0 + n, row + x0, (n < x1 - x0 - n ? n : x1 - x0 - n) * sizeof(particle_t));
+                }
+            }
+            edges[x0] ^= (uint64_t) 1 << (y & 63);
+            edges[x1] ^= (uint64_t) 1 << (y & 63);
+            if (x0 < lo) lo = x0;
+            if (x1 > hi) hi = x1;
+            if (w->active) {
+                if (val.e) {
+                    markSpan(w, y, x0, x1);
+                } else if (y > 0) {
+                    // the grains over and beside the emptied cells, as wakeAbove() for each
+                    markSpan(w, y - 1, x0 - 1, x1 + 1);
+                }
+            }
+        }
+
+        // a chunk row's rows in a column all sit in one occupancy word, so the occupancy
+        // goes a word per column and the chunk counts once per chunk
+        int k = (cy << CHUNK_SHIFT) >> 6;
+        int cx = lo >> CHUNK_SHIFT, flipped = 0;
+        uint64_t mask = 0;
+        for (int x = lo; x <= hi; x++) {
+            if (flipped && (x == hi || x >> CHUNK_SHIFT != cx)) {
+                addToChunk(w, cy, cx, val.e ? flipped : -flipped);
+                changed += flipped;
+                flipped = 0;
+            }
+            mask ^= edges[x];
+            edges[x] = 0;
+            if (!mask) continue;
+            cx = x >> CHUNK_SHIFT;
+            uint64_t* word = &w->occupancy[x * w->columnWords + k];
+            uint64_t old = *word;
+            *word = val.e ? old | mask : old & ~mask;
+            flipped += popCount(old ^ *word);
+            if (!w->trackSurface) continue;
+            if (val.e) {
+                int top = (k << 6) + bitScanForward(mask);
+                if (top < w->surface[x]) w->surface[x] = top;
+            } else if (w->surface[x] < w->height && w->surface[x] >> 6 == k && ((mask >> (w->surface[x] & 63)) & 1)) {
+                // the top grain went, the next one down is the new surface
+                w->surface[x] = firstFilledBelow(w, w->surface[x], x, w->height - 1);
+            }
+        }
+    }
+    return changed;
+}
+
+int setSpans(world_t* w, const span_t* spans, int count, particle_t val) {
+    return writeSpans(w, spans, count, val, NULL);
+}
+
+int paintSpans(world_t* w, const span_t* spans, int count, const particle_t* cells) {
+    return writeSpans(w, spans, count, (particle_t) { 0, true, false, 0 }, cells);
+}
+
+int setRect(world_t* w, int y0, int x0, int y1, int x1, particle_t val) {
+    if (y0 < 0) y0 = 0;
+    if (y1 > w->height) y1 = w->height;
+    span_t spans[CHUNK_SIZE];
+    int changed = 0;
+    // a chunk row at a time
+    for (int y = y0; y < y1;) {
+        int n = 0;
+        do {
+            spans[n++] = (span_t) { y++, x0, x1 };
+        } while (y < y1 && (y & (CHUNK_SIZE - 1)));
+        changed += setSpans(w, spans, n, val);
+    }
+    return changed;
+}
+
+// first filled row in an occupancy column strictly below y, looking no further than limit.
+// returns limit + 1 if the column is clear down to limit
+static inline int scanColumn(const uint64_t* column, int y, int limit) {
+    int start = y + 1;
+    if (start > limit) return limit + 1;
+    int i = start >> 6;
+    uint64_t bits = column[i] & (~(uint64_t) 0 << (start & 63));
+    for (;;) {
+        if (bits) {
+            int row = (i << 6) + bitScanForward(bits);
+            return row <= limit ? row : limit + 1;
+        }
+        if (++i > limit >> 6) {
+            return limit + 1;
+        }
+        bits = column[i];
+    }
+}
+
+static int firstFilledBelow(const world_t* w, int y, int x, int limit) {
+    return scanColumn(&w->occupancy[x * w->columnWords], y, limit);
+}
+
+void rebuildSurface(world_t* w) {
+    for (int j = 0; j < w->width; j++) {
+        w->surface[j] = firstFilledBelow(w, -1, j, w->height - 1);
+    }
+}
+
+#ifdef SANDSIM_CHECK
+// a check that holds in release builds too, the tests are built with them
+static void surfaceFailed(int step, int x, const char* what) {
+    fprintf(stderr, "checkSurface: %s wrong in column %d after update %d\n", what, x, step);
+    abort();
+}
+#endif
+
+void checkSurface(const world_t* w) {
+#ifdef SANDSIM_CHECK
+    for (int j = 0; j < w->width; j++) {
+        int top = w->height;
+        for (int i = w->height - 1; i >= 0; i--) {
+            bool filled = (w->occupancy[j * w->columnWords + (i >> 6)] >> (i & 63)) & 1;
+            if (filled != w->cells[cellIndex(w, i, j)].e) surfaceFailed(w->step, j, "occupancy bit");
+            if (filled) top = i;
+        }
+        if (!((w->occupancy[j * w->columnWords + (w->height >> 6)] >> (w->height & 63)) & 1)) {
+            surfaceFailed(w->step, j, "floor bit");
+        }
+        if (!w->cells[cellIndex(w, w->height, j)].a) surfaceFailed(w->step, j, "floor cell");
+        if (w->trackSurface && w->surface[j] != top) surfaceFailed(w->step, j, "surface");
+    }
+#else
+    (void) w;
+#endif
+}
+
+bool nextFreeSpan(const world_t* w, int x, int from, int* start, int* end) {
+    if (from >= w->height) return false;
+    const uint64_t* column = &w->occupancy[x * w->columnWords];
+    // skip filled cells to the start of the span
+    int y = from;
+    while (y < w->height) {
+        uint64_t free = ~column[y >> 6] & (~(uint64_t) 0 << (y & 63));
+        if (free) {
+            y = (y & ~63) + bitScanForward(free);
+            break;
+        }
+        y = (y & ~63) + 64;
+    }
+    if (y >= w->height) return false;
+    *start = y;
+    *end = firstFilledBelow(w, y - 1, x, w->height - 1);
+    return true;
+}
+
+void moveGrain(world_t* w, int y, int x, int ny, int nx) {
+    int fromChunk = (y >> CHUNK_SHIFT) * w->chunksX + (x >> CHUNK_SHIFT);
+    int toChunk = (ny >> CHUNK_SHIFT) * w->chunksX + (nx >> CHUNK_SHIFT);
+    if (w->chunkStamp[fromChunk] != w->epoch) stampChunk(w, fromChunk);
+    if (w->chunkStamp[toChunk] != w->epoch) stampChunk(w, toChunk);
+
+    particle_t* from = &w->cells[cellIndex(w, y, x)];
+    w->cells[cellIndex(w, ny, nx)] = *from;
+    *from = EMPTY;
+    w->occupancy[x * w->columnWords + (y >> 6)] &= ~((uint64_t) 1 << (y & 63));
+    w->occupancy[nx * w->columnWords + (ny >> 6)] |= (uint64_t) 1 << (ny & 63);
+    if (fromChunk != toChunk) {
+        addToChunk(w, y >> CHUNK_SHIFT, x >> CHUNK_SHIFT, -1);
+        addToChunk(w, ny >> CHUNK_SHIFT, nx >> CHUNK_SHIFT, 1);
+    }
+    if (w->trackSurface) {
+        if (ny < w->surface[nx]) w->surface[nx] = ny;
+        if (y == w->surface[x]) w->surface[x] = firstFilledBelow(w, y, x, w->height - 1);
+    }
+    if (w->active) {
+        markActive(w, ny, nx);
+        wakeAbove(w, y, x);
+    }
+}
+
+bool dropGrain(world_t* w, int x, particle_t p) {
+    if (x < 0 || x >= w->width) return false;
+    int top = w->trackSurface ? w->surface[x] : firstFilledBelow(w, -1, x, w->height - 1);
+    if (top == 0) return false;
+    set(w, top - 1, x, p);
+    return true;
+}
+
+// lowest row a grain at (y, x) can fall to this update, y itself if blocked
+static int landingRow(const world_t* w, int y, int x, int distance) {
+    int limit = y + distance;
+    if (limit > w->height - 1) limit = w->height - 1;
+    if (limit == y) return y;
+    return firstFilledBelow(w, y, x, limit) - 1;
+}
+
+// cells a grain moves this update at fall speed v
+static int fallDistance(uint16_t v) {
+    int d = 1 + (v >> 4);
+    return d < MAX_FALL ? d : MAX_FALL;
+}
+
+int displace(const world_t* w, int y, int x) {
+    if (y >= w->height - 1) return 2;
+    if (inRange(w, y + 1, x) && !at(w, y + 1, x).e) {
+        return 0;
+    }
+    bool rightPossible = false;
+    bool leftPossible = false;
+    if (inRange(w, y + 1, x + 1) && !at(w, y + 1, x + 1).e) {
+        rightPossible = true;
+    }
+    if (inRange(w, y + 1, x - 1) && !at(w, y + 1, x - 1).e) {
+        leftPossible = true;
+    }
+    if (rightPossible && leftPossible) {
+        return cellRandom(w, y, x) & 1 ? 1 : -1;
+    }
+    if (rightPossible) {
+        return 1;
+    }
+    if (leftPossible) {
+        return -1;
+    }
+    return 2;
+}
+
+void setAnchor(world_t* w, int y, int x) {
+    touchChunk(w, y, x);
+    // make sure it's not anchored
+    // bottom is empty
+    if (!at(w, y + 1, x).a) {
+        w->cells[cellIndex(w, y, x)].a = false;
+        return;
+    }
+    // bottom left is empty
+    if (inRange(w, y + 1, x - 1) && !w->cells[cellIndex(w, y + 1, x - 1)].a) {
+        w->cells[cellIndex(w, y, x)].a = false;
+        return;
+    }
+    // bottom right is empty
+    if (inRange(w, y + 1, x + 1) && !w->cells[cellIndex(w, y + 1, x + 1)].a) {
+        w->cells[cellIndex(w, y, x)].a = false;
+        return;
+    }
+    // it cannot move anywhere
+    w->cells[cellIndex(w, y, x)].a = true;
+}
+
+// the rules spelled out one cell at a time, without the occupancy bits or the border.
+// slow, but it is what every other kernel has to agree with
+static int stepReference(world_t* w, int rowLo, int rowHi) {
+    int moved = 0;
+    for (int i = rowHi - 1; i >= rowLo; --i) {
+        for (int j = 0; j < w->width; ++j) {
+            particle_t p = at(w, i, j);
+            if (!p.e) continue;
+
+            int d = displace(w, i, j);
+            if (d == 0) {
+                int distance = fallDistance(p.v);
+                int ny = i;
+                while (ny - i < distance && inRange(w, ny + 1, j) && !at(w, ny + 1, j).e) {
+                    ny++;
+                }
+                if (ny - i < distance) {
+                    p.v = 0;
+                } else if (distance < MAX_FALL) {
+                    p.v += GRAVITY;
+                }
+                set(w, i, j, EMPTY);
+                set(w, ny, j, p);
+                moved++;
+            } else if (d == -1 || d == 1) {
+                p.v = 0;
+                set(w, i, j, EMPTY);
+                set(w, i + 1, j + d, p);
+                moved++;
+            } else if (p.v) {
+                p.v = 0;
+                set(w, i, j, p);
+            }
+        }
+    }
+    return moved;
+}
+
+// the per-cell rule written against the bounds checked at()/set()/displace(), any size
+static int stepChecked(world_t* w, int rowLo, int rowHi) {
+    int moved = 0;
+    for (int i = rowHi - 1; i >= rowLo; --i) {
+        for (int j = 0; j < w->width; ++j) {
+            particle_t p = at(w, i, j);
+            if (!p.e) continue;
+
+            int d = displace(w, i, j);
+            if (d == 0) {
+                // free fall, speeding up until something stops it
+                int distance = fallDistance(p.v);
+                int ny = landingRow(w, i, j, distance);
+                if (ny - i < distance) {
+                    p.v = 0;
+                } else if (distance < MAX_FALL) {
+                    p.v += GRAVITY;
+                }
+                set(w, i, j, EMPTY);
+                set(w, ny, j, p);
+                moved++;
+            } else if (d == -1 || d == 1) {
+                p.v = 0;
+                set(w, i, j, EMPTY);
+                set(w, i + 1, j + d, p);
+                moved++;
+            } else if (p.v) {
+                p.v = 0;
+                set(w, i, j, p);
+            }
+        }
+    }
+    return moved;
+}
+
+// the same rule leaning on the border and the floor bits instead of bounds checks,
+// stamped out once for any size and once per fixed power of two size
+#define STEP_KERNEL stepSentinel
+#define STEP_WIDTH 0
+#define STEP_HEIGHT 0
+#include "step_kernel.h"
+
+#define STEP_KERNEL stepSentinel128
+#define STEP_WIDTH 128
+#define STEP_HEIGHT 128
+#include "step_kernel.h"
+
+#define STEP_KERNEL stepSentinel256
+#define STEP_WIDTH 256
+#define STEP_HEIGHT 256
+#include "step_kernel.h"
+
+#define STEP_KERNEL stepSentinel512
+#define STEP_WIDTH 512
+#define STEP_HEIGHT 512
+#include "step_kernel.h"
+
+#define STEP_KERNEL stepSentinel1024
+#define STEP_WIDTH 1024
+#define STEP_HEIGHT 1024
+#include "step_kernel.h"
+
+#define STEP_KERNEL stepSentinel2048
+#define STEP_WIDTH 2048
+#define STEP_HEIGHT 2048
+#include "step_kernel.h"
+
+#define STEP_KERNEL stepSentinel4096
+#define STEP_WIDTH 4096
+#define STEP_HEIGHT 4096
+#include "step_kernel.h"
+
+const kernel_info_t KERNELS[] = {
+    { "reference", 0, 0, stepReference },
+    { "checked", 0, 0, stepChecked },
+    { "sentinel", 0, 0, stepSentinel },
+    { "sentinel-128", 128, 128, stepSentinel128 },
+    { "sentinel-256", 256, 256, stepSentinel256 },
+    { "sentinel-512", 512, 512, stepSentinel512 },
+    { "sentinel-1024", 1024, 1024, stepSentinel1024 },
+    { "sentinel-2048", 2048, 2048, stepSentinel2048 },
+    { "sentinel-4096", 4096, 4096, stepSentinel4096 },
+};
+const int KERNEL_COUNT = sizeof(KERNELS) / sizeof(KERNELS[0]);
+
+step_kernel_t selectKernel(const world_t* w) {
+    for (int k = 0; k < KERNEL_COUNT; k++) {
+        if (KERNELS[k].width == w->width && KERNELS[k].height == w->height) return KERNELS[k].step;
+    }
+    return stepSentinel;
+}
+
+static void airbornePush(airborne_t* a, int y, int x, particle_t p) {
+    if (a->count == a->capacity) {
+        a->capacity = a->capacity ? a->capacity * 2 : 256;
+        a->y = realloc(a->y, a->capacity * sizeof(int));
+        a->x = realloc(a->x, a->capacity * sizeof(int));
+        a->v = realloc(a->v, a->capacity * sizeof(int));
+        a->distance = realloc(a->distance, a->capacity * sizeof(int));
+        a->p = realloc(a->p, a->capacity * sizeof(particle_t));
+    }
+    a->y[a->count] = y;
+    a->x[a->count] = x;
+    a->v[a->count] = p.v;
+    a->p[a->count] = p;
+    a->count++;
+}
+
+// rows [0, cut) of a column, as a mask of its 64 bit word k
+static inline uint64_t rowsAbove(int cut, int k) {
+    int n = cut - (k << 6);
+    return n <= 0 ? 0 : n >= 64 ? ~(uint64_t) 0 : ((uint64_t) 1 << n) - 1;
+}
+
+// topmost grain column x would lift that has a grain staying in the grid beside it,
+// -1 if there is none
+static int staysBeside(const world_t* w, const int* cut, int x) {
+    const int words = w->columnWords;
+    const uint64_t* column = &w->occupancy[x * words];
+    for (int k = w->surface[x] >> 6; k << 6 < cut[x]; k++) {
+        uint64_t stay = 0;
+        if (x > 0) stay |= w->occupancy[(x - 1) * words + k] & ~rowsAbove(cut[x - 1], k);
+        if (x + 1 < w->width) stay |= w->occupancy[(x + 1) * words + k] & ~rowsAbove(cut[x + 1], k);
+        uint64_t bits = column[k] & rowsAbove(cut[x], k) & stay;
+        if (bits) return (k << 6) + bitScanForward(bits);
+    }
+    return -1;
+}
+
+static void keepFrom(const world_t* w, int* cut, int x, bool* changed) {
+    int y = staysBeside(w, cut, x);
+    if (y < 0) return;
+    // the grains above it in its run would land on it, so they stay too
+    while (y > 0 && at(w, y - 1, x).e) y--;
+    cut[x] = y;
+    *changed = true;
+}
+
+// take the grains that fall through open air this update off the tops of the columns
+// in rows [0, rows). a grain qualifies when every grain above it does, the cell below
+// it is empty or holds a grain that qualifies, and so do the cells beside it. then it
+// falls in its turn in the kernel too, and nothing the kernel moves can get into the
+// cells it falls through, so moving it after every other grain changes nothing
+static void liftAirborne(world_t* w, int rows) {
+    airborne_t* a = &w->airborne;
+    if (!a->cut) a->cut = malloc(w->width * sizeof(int));
+    int* cut = a->cut;
+
+    // every run of grains with an empty cell under it, down to the first one resting on
+    // something or reaching past the rows being updated
+    for (int x = 0; x < w->width; x++) {
+        int y = w->surface[x], start, end;
+        while (y < rows && nextFreeSpan(w, x, y, &start, &end) && start <= rows) {
+            y = end;
+        }
+        cut[x] = y;
+    }
+    // leaving a grain in the grid can leave the ones beside it needing to stay too,
+    // in either direction
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int x = 0; x < w->width; x++) keepFrom(w, cut, x, &changed);
+        for (int x = w->width - 1; x >= 0; x--) keepFrom(w, cut, x, &changed);
+    }
+
+    a->count = 0;
+    for (int x = 0; x < w->width; x++) {
+        const uint64_t* column = &w->occupancy[x * w->columnWords];
+        for (int k = w->surface[x] >> 6; k << 6 < cut[x]; k++) {
+            uint64_t bits = column[k] & rowsAbove(cut[x], k);
+            while (bits) {
+                int y = (k << 6) + bitScanForward(bits);
+                bits &= bits - 1;
+                airbornePush(a, y, x, at(w, y, x));
+                set(w, y, x, EMPTY);
+            }
+        }
+    }
+}
+
+// put the lifted grains back where they fall to, lowest in each column first
+static int dropAirborne(world_t* w) {
+    airborne_t* a = &w->airborne;
+    for (int k = 0; k < a->count; k++) {
+        int d = 1 + (a->v[k] >> 4);
+        a->distance[k] = d < MAX_FALL ? d : MAX_FALL;
+    }
+    for (int k = a->count - 1; k >= 0; k--) {
+        int y = a->y[k], x = a->x[k], d = a->distance[k];
+        int ny = firstFilledBelow(w, y, x, y + d) - 1;
+        assert(ny > y);
+        particle_t p = a->p[k];
+        if (ny - y < d) {
+            p.v = 0;
+        } else if (d < MAX_FALL) {
+            p.v += GRAVITY;
+        }
+        set(w, ny, x, p);
+    }
+    return a->count;
+}
+
+// every grain goes on the list, for when it wasn't kept up
+static void activateAll(world_t* w) {
+    if (!w->active) {
+        w->active = malloc((size_t) w->height * w->activeWords * sizeof(uint64_t));
+        w->activeRow = malloc(w->height * sizeof(bool));
+    }
+    memset(w->active, 0, (size_t) w->height * w->activeWords * sizeof(uint64_t));
+    memset(w->activeRow, 0, w->height * sizeof(bool));
+    for (int x = 0; x < w->width; x++) {
+        const uint64_t* column = &w->occupancy[x * w->columnWords];
+        for (int k = 0; k < w->columnWords; k++) {
+            uint64_t bits = column[k];
+            while (bits) {
+                int y = (k << 6) + bitScanForward(bits);
+                bits &= bits - 1;
+                if (y < w->height) markActive(w, y, x);
+            }
+        }
+    }
+    w->activeValid = true;
+}
+
+// grain (i, j)'s turn by the rule of step_kernel.h. returns whether it moved
+static bool stepGrain(world_t* w, int i, int j) {
+    particle_t* row = &w->cells[cellIndex(w, i, 0)];
+    particle_t* below = row + w->stride;
+    if (!row[j].e) return false;
+    particle_t p = row[j];
+
+    int ny, nx;
+    if (!below[j].e) {
+        int distance = fallDistance(p.v);
+        ny = scanColumn(&w->occupancy[j * w->columnWords], i, i + distance) - 1;
+        nx = j;
+        if (ny - i < distance) {
+            p.v = 0;
+        } else if (distance < MAX_FALL) {
+            p.v += GRAVITY;
+        }
+    } else {
+        bool rightPossible = !below[j + 1].e;
+        bool leftPossible = !below[j - 1].e;
+        if (rightPossible && leftPossible) {
+            nx = cellRandom(w, i, j) & 1 ? j + 1 : j - 1;
+        } else if (rightPossible) {
+            nx = j + 1;
+        } else if (leftPossible) {
+            nx = j - 1;
+        } else {
+            if (p.v) {
+                touchChunk(w, i, j);
+                row[j].v = 0;
+            }
+            return false;
+        }
+        ny = i + 1;
+        p.v = 0;
+    }
+    touchChunk(w, i, j);
+    row[j] = p;
+    moveGrain(w, i, j, ny, nx);
+    return true;
+}
+
+// the listed grains bottom row first, left to right, the order the kernels sweep in.
+// a grain moving out of a cell lists the ones above it, which come later this update
+static int updateActive(world_t* w) {
+    if (!w->activeValid) activateAll(w);
+    int moved = 0;
+    for (int i = w->height - 1; i >= 0; i--) {
+        if (!w->activeRow[i]) continue;
+        w->activeRow[i] = false;
+        uint64_t* bits = &w->active[i * w->activeWords];
+        for (int k = 0; k < w->activeWords; k++) {
+            while (bits[k]) {
+                int j = (k << 6) + bitScanForward(bits[k]);
+                bits[k] &= bits[k] - 1;
+                moved += stepGrain(w, i, j);
+            }
+        }
+    }
+    w->step++;
+    checkSurface(w);
+    return moved;
+}
+
+// rows are updated in place from the bottom up, so a grain only ever moves into
+// rows that have already been updated this step and is never moved twice.
+// grains only move down, so nothing above the highest surface needs a look
+int UpdateGrid(world_t* w) {
+    if (w->worklist) return updateActive(w);
+    return UpdateBand(w, w->height);
+}
+
+void blockShape(const world_t* w, long cacheBytes, int* steps, int* rows) {
+    // a pass holds a band per update plus the one below the lowest it lands in
+    long rowBytes = (long) w->stride * sizeof(particle_t);
+    int band = MAX_FALL > 1 ? MAX_FALL : 1;
+    long k = cacheBytes / (rowBytes * band) - 1;
+    k = k < 1 ? 1 : k > MAX_BLOCK_STEPS ? MAX_BLOCK_STEPS : k;
+    // room to spare goes into taller bands, fewer of them
+    long fit = cacheBytes / (rowBytes * (k + 1));
+    if (fit > band) band = fit < w->height ? (int) fit : w->height;
+    *steps = (int) k;
+    *rows = band;
+}
+
+// one pass of steps updates, as a wavefront of bands of rows bands tall moving up the
+// world with update s + 1 a band behind update s. a band of update s + 1 needs update
+// s done on every row a grain could fall into it from, which is the band above at most
+// since bands are at least MAX_FALL rows tall, and update s + 1 running below update s
+// never changes a row update s still has to read
+static int highestSurface(const world_t* w) {
+    if (!w->trackSurface) return 0;
+    int top = w->height;
+    for (int j = 0; j < w->width; ++j) {
+        if (w->surface[j] < top) top = w->surface[j];
+    }
+    return top;
+}
+
+static int blockedPass(world_t* w, int steps, int rows) {
+    // grains only fall, so no update of the pass has anything to do above the first's top
+    int top = highestSurface(w);
+    int bands = (w->height - top + rows - 1) / rows;
+    uint32_t first = w->step;
+    int moved = 0;
+    for (int t = 0; t < bands + steps - 1; t++) {
+        for (int s = 0; s < steps; s++) {
+            int b = t - s;
+            if (b < 0 || b >= bands) continue;
+            int hi = w->height - b * rows;
+            // every update before s is done with this band, so nothing lands above the
+            // highest grain in it any more
+            int lo = hi - rows > top ? hi - rows : top;
+            int now = highestSurface(w);
+            if (now > lo) lo = now;
+            if (lo >= hi) continue;
+            w->step = first + s;
+            moved += w->kernel(w, lo, hi);
+        }
+    }
+    w->step = first + steps;
+    return moved;
+}
+
+int UpdateGridBlocked(world_t* w, int steps, long cacheBytes) {
+    int moved = 0;
+    if (w->liftAirborne) {
+        for (int s = 0; s < steps; s++) moved += UpdateGrid(w);
+        return moved;
+    }
+    while (steps > 0) {
+        int k, rows;
+        blockShape(w, cacheBytes, &k, &rows);
+        if (k > steps) k = steps;
+        moved += blockedPass(w, k, rows);
+        steps -= k;
+    }
+    w->activeValid = false;
+    checkSurface(w);
+    return moved;
+}
+
+int UpdateBand(world_t* w, int rows) {
+    bool lift = w->liftAirborne && w->trackSurface;
+    if (lift) liftAirborne(w, rows);
+
+    int top = 0;
+    if (w->trackSurface) {
+        top = w->height;
+        for (int j = 0; j < w->width; ++j) {
+            if (w->surface[j] < top) top = w->surface[j];
+        }
+    }
+
+    int moved = top < rows ? w->kernel(w, top, rows) : 0;
+    if (lift) moved += dropAirborne(w);
+    // the kernels don't keep the worklist
+    w->activeValid = false;
+
+    w->step++;
+    checkSurface(w);
+    return moved;
+}
+
+int lerp(BYTE start, BYTE end, float t) {
+    return (int) (start + (end - start) * t);
+}
+
+void interpolateColor(world_t* w) {
+    w->colorPercent += w->colorRate * w->colorDirection;
+    if (w->colorPercent > 1.0) {
+        w->colorDirection = -1;
+        w->colorPercent = 1;
+    }
+    if (w->colorPercent < 0.0) {
+        w->colorDirection = 1;
+        w->colorPercent = 0;
+    }
+
+    if (w->colorPercent <= 0.50) {
+        w->currentColor = RGB(
+                    lerp(COLOR_1.rgbtRed, COLOR_2.rgbtRed, w->colorPercent * 2),
+                    lerp(COLOR_1.rgbtGreen, COLOR_2.rgbtGreen, w->colorPercent * 2),
+                    lerp(COLOR_1.rgbtBlue, COLOR_2.rgbtBlue, w->colorPercent * 2)
+                );
+    } else {
+        w->currentColor = RGB(
+                lerp(COLOR_2.rgbtRed, COLOR_3.rgbtRed,    (w->colorPercent - 0.50) * 2),
+                lerp(COLOR_2.rgbtGreen, COLOR_3.rgbtGreen,(w->colorPercent - 0.50) * 2),
+                lerp(COLOR_2.rgbtBlue, COLOR_3.rgbtBlue,  (w->colorPercent - 0.50) * 2)
+        );
+    }
+}
+
+// paint a disc of fresh grains centered on the top middle of the world
+void pour(world_t* w, int radius) {
+    int cx = w->width / 2;
+    for (int i = 0; i < radius; i++) {
+        for (int j = cx - radius + 1; j < cx + radius; j++) {
+            if ((i - radius) * (i - radius) + (j - cx) * (j - cx) >= radius * radius) continue;
+            if (!inRange(w, i, j) || at(w, i, j).e) continue;
+            interpolateColor(w);
+            set(w, i, j, (particle_t) { w->currentColor, true, false, 0 });
+        }
+    }
+}
+
+int countGrains(const world_t* w) {
+    return chunkPrefix(w, w->chunksY, w->chunksX);
+}
+
+int countChunks(const world_t* w, int cy0, int cx0, int cy1, int cx1) {
+    if (cy0 < 0) cy0 = 0;
+    if (cx0 < 0) cx0 = 0;
+    if (cy1 > w->chunksY) cy1 = w->chunksY;
+    if (cx1 > w->chunksX) cx1 = w->chunksX;
+    if (cy0 >= cy1 || cx0 >= cx1) return 0;
+    return chunkPrefix(w, cy1, cx1) - chunkPrefix(w, cy0, cx1) - chunkPrefix(w, cy1, cx0) + chunkPrefix(w, cy0, cx0);
+}
+
+// grains in rows [y0, y1) of column x
+static int columnRange(const world_t* w, int x, int y0, int y1) {
+    if (y0 >= y1) return 0;
+    const uint64_t* column = &w->occupancy[x * w->columnWords];
+    int first = y0 >> 6, last = (y1 - 1) >> 6;
+    int count = 0;
+    for (int k = first; k <= last; k++) {
+        uint64_t bits = column[k];
+        if (k == first) bits &= ~(uint64_t) 0 << (y0 & 63);
+        if (k == last && (y1 & 63)) bits &= ~(~(uint64_t) 0 << (y1 & 63));
+        count += popCount(bits);
+    }
+    return count;
+}
+
+int countRect(const world_t* w, int y0, int x0, int y1, int x1) {
+    if (y0 < 0) y0 = 0;
+    if (x0 < 0) x0 = 0;
+    if (y1 > w->height) y1 = w->height;
+    if (x1 > w->width) x1 = w->width;
+    if (y0 >= y1 || x0 >= x1) return 0;
+
+    // chunks wholly inside. one cut short by the edge of the world counts as whole
+    // when the rectangle reaches the edge
+    int cx0 = (x0 + CHUNK_SIZE - 1) >> CHUNK_SHIFT;
+    int cy0 = (y0 + CHUNK_SIZE - 1) >> CHUNK_SHIFT;
+    int cx1 = x1 == w->width ? w->chunksX : x1 >> CHUNK_SHIFT;
+    int cy1 = y1 == w->height ? w->chunksY : y1 >> CHUNK_SHIFT;
+    int count = 0;
+    if (cx0 >= cx1 || cy0 >= cy1) {
+        for (int x = x0; x < x1; x++) count += columnRange(w, x, y0, y1);
+        return count;
+    }
+
+    int innerX0 = cx0 << CHUNK_SHIFT, innerY0 = cy0 << CHUNK_SHIFT;
+    int innerX1 = cx1 == w->chunksX ? w->width : cx1 << CHUNK_SHIFT;
+    int innerY1 = cy1 == w->chunksY ? w->height : cy1 << CHUNK_SHIFT;
+    count = countChunks(w, cy0, cx0, cy1, cx1);
+    for (int x = x0; x < innerX0; x++) count += columnRange(w, x, y0, y1);
+    for (int x = innerX1; x < x1; x++) count += columnRange(w, x, y0, y1);
+    for (int x = innerX0; x < innerX1; x++) {
+        count += columnRange(w, x, y0, innerY0) + columnRange(w, x, innerY1, y1);
+    }
+    return count;
+}
+
+int columnGrains(const world_t* w, int x) {
+    return x >= 0 && x < w->width ? columnRange(w, x, 0, w->height) : 0;
+}
+
+uint64_t hashWorld(const world_t* w) {
+    // FNV-1a over (index, color) of every filled cell
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (int i = 0; i < w->height; i++) {
+        for (int j = 0; j < w->width; j++) {
+            const particle_t* p = &w->cells[cellIndex(w, i, j)];
+            if (!p->e) continue;
+            uint32_t words[2] = { (uint32_t) (i * w->width + j), p->c };
+            const BYTE* bytes = (const BYTE*) words;
+            for (int k = 0; k < 8; k++) {
+                h = (h ^ bytes[k]) * 0x100000001b3ull;
+            }
+        }
+    }
+    return h;
+}
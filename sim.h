@@ -0,0 +1,273 @@
+#ifndef SANDSIM_SIM_H
+#define SANDSIM_SIM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+// stand-ins for the few win32 types the simulation uses
+typedef uint32_t COLORREF;
+typedef uint8_t BYTE;
+typedef struct tagRGBTRIPLE {
+    BYTE rgbtBlue;
+    BYTE rgbtGreen;
+    BYTE rgbtRed;
+} RGBTRIPLE;
+#define RGB(r, g, b) ((COLORREF) (((BYTE) (r)) | ((COLORREF) ((BYTE) (g)) << 8) | ((COLORREF) ((BYTE) (b)) << 16)))
+#endif
+
+// particle struct
+typedef struct particle {
+    COLORREF c; // color
+    bool e; // exists
+    bool a; // anchored
+    uint16_t v; // fall speed, in 1/16 cells per update
+} particle_t;
+
+// side of the square chunks changes are tracked in
+#define CHUNK_SHIFT 5
+#define CHUNK_SIZE (1 << CHUNK_SHIFT)
+
+struct world;
+
+// grains falling through open air, taken out of the grid for the update that moves
+// them. a field per array so working out how far they all fall is one plain loop
+typedef struct airborne {
+    int count;
+    int capacity;
+    int* y;
+    int* x;
+    int* v;
+    int* distance;
+    particle_t* p;
+    // first row of each column left in the grid
+    int* cut;
+} airborne_t;
+
+// advances rows [rowLo, rowHi) of a world by one update, bottom row first.
+// returns the number of grains that moved
+typedef int (*step_kernel_t)(struct world* w, int rowLo, int rowHi);
+
+// columns [x0, x1) of row y
+typedef struct span {
+    int y;
+    int x0;
+    int x1;
+} span_t;
+
+// one independent sandbox
+typedef struct world {
+    // grid width/height
+    int width;
+    int height;
+    // grid, with a one cell solid border all around so neighbours never need a bounds check
+    particle_t* cells;
+    // cells per grid row, border included
+    int stride;
+
+    // occupancy bits, one column after another, bit y of a column is set if (y, x) is filled
+    uint64_t* occupancy;
+    // 64 bit words per column
+    int columnWords;
+    // topmost filled row of each column, height for an empty column
+    int* surface;
+    // keep the surfaces up to date
+    bool trackSurface;
+
+    // chunks across/down
+    int chunksX;
+    int chunksY;
+    // epoch each chunk was last written in
+    uint32_t* chunkStamp;
+    // epoch new writes are stamped with
+    uint32_t epoch;
+    // grains in each chunk, kept up to date by every write
+    int* chunkGrains;
+    // the same counts as a fenwick tree over chunk rows and columns, so the grains in
+    // any rectangle of whole chunks add up in O(log chunksY * log chunksX)
+    int* chunkTree;
+    // while set, called with a chunk's index before it is first written in an epoch
+    void (*beforeWrite)(struct world* w, int chunk);
+    // checkpoint being written in the background, see checkpoint.h
+    struct checkpoint* checkpoint;
+
+    // step kernel picked for this world's size
+    step_kernel_t kernel;
+    // move grains falling through open air as a list instead of sweeping every row
+    // they are in. needs the surfaces, ends up exactly where the kernel would
+    bool liftAirborne;
+    airborne_t airborne;
+    // step only the grains that may move instead of sweeping every row. a grain that
+    // moved, or had a cell under it emptied, goes on the list for its next turn.
+    // UpdateGrid() uses it in place of liftAirborne
+    bool worklist;
+    // grains on the list, a bitset of columns per row
+    uint64_t* active;
+    // 64 bit words per row of active
+    int activeWords;
+    // rows with any bit set in active
+    bool* activeRow;
+    // the list holds every grain that may move. updates that don't keep it clear this
+    bool activeValid;
+
+    // where setSpans() starts or stops writing rows along a chunk row, width + 1 words
+    // kept all clear between calls. allocated on first use
+    uint64_t* spanEdges;
+
+    // random seed and updates done so far
+    uint32_t seed;
+    uint32_t step;
+    // row of a larger world that this world's row 0 stands for, when it is one band of it
+    int originY;
+
+    // color change per update
+    float colorRate;
+    // percent through gradient
+    double colorPercent;
+    // gradient color going left/right
+    int colorDirection;
+    // current color
+    COLORREF currentColor;
+} world_t;
+
+// color change per update for new worlds
+extern float COLOR_PERCENT;
+// fall speed gained per update, in 1/16 cells
+extern int GRAVITY;
+// terminal fall speed, in cells per update
+extern int MAX_FALL;
+// most updates UpdateGridBlocked() runs in one pass
+#define MAX_BLOCK_STEPS 32
+
+// 3 color gradient
+extern RGBTRIPLE COLOR_1;
+extern RGBTRIPLE COLOR_2;
+extern RGBTRIPLE COLOR_3;
+
+// def of empty grid
+extern const particle_t EMPTY;
+// def of the border around the grid
+extern const particle_t WALL;
+
+// a step kernel and the world size it is specialized for, 0 for any size
+typedef struct kernel_info {
+    const char* name;
+    int width;
+    int height;
+    step_kernel_t step;
+} kernel_info_t;
+
+extern const kernel_info_t KERNELS[];
+extern const int KERNEL_COUNT;
+
+// fastest kernel able to step a world of w's size
+step_kernel_t selectKernel(const world_t* w);
+
+// position of cell (y, x) in w->cells
+static inline int cellIndex(const world_t* w, int y, int x) {
+    return (y + 1) * w->stride + x + 1;
+}
+
+// random bits for cell (y, x) on the current update. depends only on the seed,
+// the update and the position, so it doesn't matter in which order cells are visited
+static inline uint32_t cellRandom(const world_t* w, int y, int x) {
+    uint32_t h = w->seed ^ w->step * 0x9E3779B1u ^ (uint32_t) (y + w->originY) * 0x85EBCA77u ^ (uint32_t) x * 0xC2B2AE3Du;
+    h ^= h >> 15;
+    h *= 0x2C1B3C6Du;
+    h ^= h >> 12;
+    h *= 0x297A2D39u;
+    h ^= h >> 15;
+    return h;
+}
+
+// cell rectangle chunk c of a width x height world covers, clipped to the world
+static inline void chunkBounds(int width, int height, int c, int* x0, int* y0, int* x1, int* y1) {
+    int chunksX = (width + CHUNK_SIZE - 1) >> CHUNK_SHIFT;
+    *x0 = (c % chunksX) << CHUNK_SHIFT;
+    *y0 = (c / chunksX) << CHUNK_SHIFT;
+    *x1 = *x0 + CHUNK_SIZE < width ? *x0 + CHUNK_SIZE : width;
+    *y1 = *y0 + CHUNK_SIZE < height ? *y0 + CHUNK_SIZE : height;
+}
+
+// stamp chunk c as written in the current epoch, on its first write of the epoch
+static inline void stampChunk(world_t* w, int c) {
+    if (w->beforeWrite) w->beforeWrite(w, c);
+    w->chunkStamp[c] = w->epoch;
+}
+
+// stamp the chunk holding cell (y, x). call it before writing the cell, so a
+// checkpoint still reading the chunk can save it first
+static inline void touchChunk(world_t* w, int y, int x) {
+    int c = (y >> CHUNK_SHIFT) * w->chunksX + (x >> CHUNK_SHIFT);
+    if (w->chunkStamp[c] != w->epoch) stampChunk(w, c);
+}
+
+// ends the current epoch and returns it. chunks with a stamp above the returned
+// value have been written since this call
+uint32_t nextEpoch(world_t* w);
+
+void worldInit(world_t* w, int width, int height, uint32_t seed);
+void worldFree(world_t* w);
+// empty every cell
+void worldClear(world_t* w);
+
+bool inRange(const world_t* w, int y, int x);
+particle_t at(const world_t* w, int y, int x);
+void set(world_t* w, int y, int x, particle_t val);
+// set() every cell of the spans, clipped to the world. the spans must come in order of
+// row and not overlap within a row. each chunk is stamped and counted once and the
+// occupancy is written a word per column for every chunk row. returns the number of
+// cells that went from empty to filled or back
+int setSpans(world_t* w, const span_t* spans, int count, particle_t val);
+// setSpans() with a grain of its own for every cell, taken from cells in span order.
+// every one of them must be filled
+int paintSpans(world_t* w, const span_t* spans, int count, const particle_t* cells);
+// setSpans() over the cells of [y0, x0) to (y1, x1)
+int setRect(world_t* w, int y0, int x0, int y1, int x1, particle_t val);
+int displace(const world_t* w, int y, int x);
+void setAnchor(world_t* w, int y, int x);
+
+// recompute every column surface from the occupancy bits
+void rebuildSurface(world_t* w);
+// with SANDSIM_CHECK defined, aborts unless the occupancy bits and surfaces match the
+// grid. a full scan, so only the tests turn it on
+void checkSurface(const world_t* w);
+// first run of empty cells in column x at or below row from, as [start, end)
+bool nextFreeSpan(const world_t* w, int x, int from, int* start, int* end);
+// move the grain at (y, x) into the empty cell (ny, nx), bookkeeping and all.
+// cheaper than the two set() calls it stands for
+void moveGrain(world_t* w, int y, int x, int ny, int nx);
+// stack a grain on top of column x, false if the column is full
+bool dropGrain(world_t* w, int x, particle_t p);
+
+// advance one update, returns the number of grains that moved
+int UpdateGrid(world_t* w);
+// advance one update of rows [0, rows) only. rows below belong to a neighbour
+// and are only looked at and landed in
+int UpdateBand(world_t* w, int rows);
+// advance steps updates, several per pass over the world so each band of rows is read
+// once a pass instead of once an update while the pass stays within cacheBytes of
+// cache. ends up exactly where calling UpdateGrid() steps times would
+int UpdateGridBlocked(world_t* w, int steps, long cacheBytes);
+// updates per pass and band height in rows UpdateGridBlocked() uses for w
+void blockShape(const world_t* w, long cacheBytes, int* steps, int* rows);
+void interpolateColor(world_t* w);
+
+// paint a disc of fresh grains centered on the top middle of the world
+void pour(world_t* w, int radius);
+
+// number of filled cells
+int countGrains(const world_t* w);
+// grains in chunks [cy0, cy1) x [cx0, cx1), from the chunk tree
+int countChunks(const world_t* w, int cy0, int cx0, int cy1, int cx1);
+// grains in cells [y0, y1) x [x0, x1), clipped to the world. the whole chunks inside
+// come from the chunk tree, only the strips of cells around them are counted bit by bit
+int countRect(const world_t* w, int y0, int x0, int y1, int x1);
+// grains in column x
+int columnGrains(const world_t* w, int x);
+// hash of the filled cells and their colors
+uint64_t hashWorld(const world_t* w);
+
+#endif
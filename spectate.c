@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "net.h"
+#include "stream.h"
+
+// headless spectator: rebuilds the world from a sandsim_bench --serve stream and
+// checks the frames that carry a hash against it
+static void usage() {
+    fprintf(stderr, "usage: sandsim_spectate [--host HOST] [--port N] [--frames N]\n");
+    exit(1);
+}
+
+int main(int argc, char** argv) {
+    const char* host = "127.0.0.1";
+    int port = 7878;
+    int frames = 0;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--host") == 0) {
+            host = argv[++i];
+        } else if (i + 1 < argc && strcmp(argv[i], "--port") == 0) {
+            port = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--frames") == 0) {
+            frames = atoi(argv[++i]);
+        } else {
+            usage();
+        }
+    }
+
+    net_socket_t s = netConnect(host, port);
+    if (s == NET_INVALID) {
+        fprintf(stderr, "can't connect to %s:%d\n", host, port);
+        return 1;
+    }
+
+    view_t view = { 0 };
+    uint8_t* payload = NULL;
+    size_t capacity = 0;
+    size_t total = 0;
+    int received = 0, checked = 0, mismatches = 0;
+    uint8_t raw[FRAME_HEADER_SIZE];
+    while ((frames == 0 || received < frames) && netRecv(s, raw, sizeof(raw))) {
+        frame_header_t header;
+        if (!readFrameHeader(raw, &header)) {
+            fprintf(stderr, "bad frame header\n");
+            return 1;
+        }
+        if (header.bytes > capacity) {
+            capacity = header.bytes;
+            payload = realloc(payload, capacity);
+        }
+        if (!netRecv(s, payload, header.bytes) || !applyFrame(&view, &header, payload)) {
+            fprintf(stderr, "bad frame at update %u\n", header.step);
+            return 1;
+        }
+        total += sizeof(raw) + header.bytes;
+        received++;
+
+        if (!header.hashed) continue;
+        checked++;
+        if (hashView(&view) != header.hash) {
+            mismatches++;
+            fprintf(stderr, "hash mismatch at update %u\n", header.step);
+        }
+    }
+    netClose(s);
+
+    printf("%d frames, %zu bytes, world %dx%d at update %u, %d hashed, %d hash mismatches\n",
+           received, total, view.width, view.height, view.step, checked, mismatches);
+    viewFree(&view);
+    free(payload);
+    return received > 0 && mismatches == 0 ? 0 : 1;
+}
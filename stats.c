@@ -0,0 +1,157 @@
+#include "stats.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// 3x5 glyphs, a row per octal digit from the top, the high bit of each on the left
+static const uint16_t GLYPHS[128] = {
+    ['0'] = 075557, ['1'] = 026227, ['2'] = 071747, ['3'] = 071717, ['4'] = 055711,
+    ['5'] = 074717, ['6'] = 074757, ['7'] = 071111, ['8'] = 075757, ['9'] = 075717,
+    ['A'] = 025755, ['B'] = 065656, ['C'] = 034443, ['D'] = 065556, ['E'] = 074647,
+    ['F'] = 074644, ['G'] = 034553, ['H'] = 055755, ['I'] = 072227, ['J'] = 011152,
+    ['K'] = 055655, ['L'] = 044447, ['M'] = 057755, ['N'] = 065555, ['O'] = 025552,
+    ['P'] = 065644, ['Q'] = 025563, ['R'] = 065655, ['S'] = 034216, ['T'] = 072222,
+    ['U'] = 055557, ['V'] = 055552, ['W'] = 055775, ['X'] = 055255, ['Y'] = 055222,
+    ['Z'] = 071247, ['.'] = 000002, ['/'] = 011244, [':'] = 002020, ['-'] = 000700,
+    ['%'] = 051245,
+};
+
+// weight of the newest frame in the running averages
+static const double SMOOTHING = 0.1;
+
+// pixels per glyph dot, the advance from one character to the next and from one line
+// to the next, the margin inside the panel and the height of the graph
+enum { DOT = 2, ADVANCE = 4 * DOT, LINE = 6 * DOT, PAD = 6, GRAPH = 64 };
+
+static const uint32_t TEXT = 0xE0E0E0;
+static const uint32_t BAR = 0x5090E0;
+static const uint32_t P50 = 0x40D040;
+static const uint32_t P99 = 0xE04040;
+
+static void average(double* ms, double seconds, bool first) {
+    *ms = first ? seconds * 1e3 : *ms + (seconds * 1e3 - *ms) * SMOOTHING;
+}
+
+void statsInit(stats_t* s, world_t* w) {
+    memset(s, 0, sizeof(*s));
+    s->chunks = w->chunksX * w->chunksY;
+    s->grains = countGrains(w);
+    s->since = nextEpoch(w);
+}
+
+void statsFrame(stats_t* s, world_t* w, int steps, double stepSeconds, double brushSeconds, double renderSeconds,
+                double frameSeconds) {
+    average(&s->stepMs, stepSeconds, !s->frames);
+    average(&s->brushMs, brushSeconds, !s->frames);
+    average(&s->renderMs, renderSeconds, !s->frames);
+    s->frameMs[s->next] = (float) (frameSeconds * 1e3);
+    s->next = (s->next + 1) % STATS_FRAMES;
+    if (s->count < STATS_FRAMES) s->count++;
+    s->frames++;
+    s->steps += steps;
+
+    s->windowSteps += steps;
+    s->windowSeconds += frameSeconds;
+    if (s->windowSeconds >= 1) {
+        s->stepRate = s->windowSteps / s->windowSeconds;
+        s->windowSteps = 0;
+        s->windowSeconds = 0;
+    } else if (s->steps == s->windowSteps) {
+        // until the first second is up, the rate so far
+        s->stepRate = s->windowSeconds > 0 ? s->windowSteps / s->windowSeconds : 0;
+    }
+
+    s->grains = countGrains(w);
+    s->chunks = w->chunksX * w->chunksY;
+    int active = 0;
+    for (int c = 0; c < s->chunks; c++) {
+        active += w->chunkStamp[c] > s->since;
+    }
+    s->activeChunks = active;
+    s->since = nextEpoch(w);
+}
+
+static int compareMs(const void* a, const void* b) {
+    float x = *(const float*) a, y = *(const float*) b;
+    return (x > y) - (x < y);
+}
+
+double statsPercentile(const stats_t* s, double p) {
+    if (!s->count) return 0;
+    float sorted[STATS_FRAMES];
+    // until the ring is full the frames are at its start
+    memcpy(sorted, s->frameMs, s->count * sizeof(float));
+    qsort(sorted, s->count, sizeof(float), compareMs);
+    int i = (int) (p * (s->count - 1) + 0.5);
+    if (i < 0) i = 0;
+    if (i >= s->count) i = s->count - 1;
+    return sorted[i];
+}
+
+void statsPrint(const stats_t* s, FILE* out) {
+    fprintf(out, "%lld frames, %.0f updates/s, step %.3f ms, brush %.3f ms, render %.3f ms, "
+                 "frame p50 %.2f ms p99 %.2f ms, %d grains, %d/%d chunks written\n",
+            s->frames, s->stepRate, s->stepMs, s->brushMs, s->renderMs, statsPercentile(s, 0.5),
+            statsPercentile(s, 0.99), s->grains, s->activeChunks, s->chunks);
+}
+
+// [x0, x1) x [y0, y1) clipped to the image, set to color or with darken a quarter as bright
+static void fillBox(uint32_t* pixels, int width, int height, int x0, int y0, int x1, int y1, uint32_t color,
+                    bool darken) {
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 > width) x1 = width;
+    if (y1 > height) y1 = height;
+    for (int y = y0; y < y1; y++) {
+        uint32_t* row = pixels + (size_t) y * width;
+        for (int x = x0; x < x1; x++) {
+            row[x] = darken ? (row[x] >> 2) & 0x3F3F3F : color;
+        }
+    }
+}
+
+static void drawText(uint32_t* pixels, int width, int height, int x, int y, const char* text, uint32_t color) {
+    for (; *text; text++, x += ADVANCE) {
+        uint16_t glyph = GLYPHS[*text & 127];
+        for (int row = 0; row < 5; row++) {
+            for (int col = 0; col < 3; col++) {
+                if (!((glyph >> ((4 - row) * 3 + 2 - col)) & 1)) continue;
+                fillBox(pixels, width, height, x + col * DOT, y + row * DOT, x + (col + 1) * DOT,
+                        y + (row + 1) * DOT, color, false);
+            }
+        }
+    }
+}
+
+void statsDraw(const stats_t* s, uint32_t* pixels, int width, int height, int x, int y) {
+    enum { LINES = 7 };
+    int panelHeight = PAD + LINES * LINE + PAD + GRAPH + PAD;
+    fillBox(pixels, width, height, x, y, x + STATS_FRAMES + 2 * PAD, y + panelHeight, 0, true);
+
+    double p50 = statsPercentile(s, 0.5), p99 = statsPercentile(s, 0.99);
+    char line[LINES][48];
+    snprintf(line[0], sizeof(line[0]), "STEPS/S %.0f", s->stepRate);
+    snprintf(line[1], sizeof(line[1]), "STEP %.2f MS BRUSH %.2f MS", s->stepMs, s->brushMs);
+    snprintf(line[2], sizeof(line[2]), "RENDER %.2f MS", s->renderMs);
+    snprintf(line[3], sizeof(line[3]), "GRAINS %d", s->grains);
+    snprintf(line[4], sizeof(line[4]), "CHUNKS %d/%d", s->activeChunks, s->chunks);
+    snprintf(line[5], sizeof(line[5]), "FRAME P50 %.1f MS", p50);
+    snprintf(line[6], sizeof(line[6]), "FRAME P99 %.1f MS", p99);
+    for (int i = 0; i < LINES; i++) {
+        drawText(pixels, width, height, x + PAD, y + PAD + i * LINE, line[i], i == 5 ? P50 : i == 6 ? P99 : TEXT);
+    }
+
+    // a bar per frame, the newest on the right, up to twice the p99 frame
+    int left = x + PAD, bottom = y + panelHeight - PAD;
+    double top = p99 > 0.5 ? 2 * p99 : 1;
+    for (int i = 0; i < s->count; i++) {
+        double ms = s->frameMs[(s->next - s->count + i + STATS_FRAMES) % STATS_FRAMES];
+        int bar = (int) (ms / top * GRAPH + 0.5);
+        if (bar > GRAPH) bar = GRAPH;
+        int column = left + STATS_FRAMES - s->count + i;
+        fillBox(pixels, width, height, column, bottom - bar, column + 1, bottom, ms > p99 ? P99 : BAR, false);
+    }
+    int y50 = bottom - (int) (p50 / top * GRAPH + 0.5), y99 = bottom - (int) (p99 / top * GRAPH + 0.5);
+    fillBox(pixels, width, height, left, y50, left + STATS_FRAMES, y50 + 1, P50, false);
+    fillBox(pixels, width, height, left, y99, left + STATS_FRAMES, y99 + 1, P99, false);
+}
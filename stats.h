@@ -0,0 +1,57 @@
+#ifndef SANDSIM_STATS_H
+#define SANDSIM_STATS_H
+
+#include <stdio.h>
+
+#include "sim.h"
+
+// counters kept every frame whether or not anyone looks at them: what the updates,
+// the brush and the render cost, how many grains there are and how many chunks were
+// written, and the times of the last frames for their percentiles. keeping them is a
+// few stores and a pass over the chunk stamps; the percentiles are only sorted out
+// when printed or drawn. the overlay is drawn into the frame after the render has
+// been timed, so showing it doesn't change what it shows
+
+// frames kept for the percentiles and the graph
+#define STATS_FRAMES 256
+
+typedef struct stats {
+    // times of the last frames, ms, a ring oldest at next once full
+    float frameMs[STATS_FRAMES];
+    int next;
+    int count;
+    // running averages of what a frame spends, ms
+    double stepMs;
+    double brushMs;
+    double renderMs;
+    // updates per second over the last whole second
+    double stepRate;
+    // updates and seconds towards the next stepRate
+    int windowSteps;
+    double windowSeconds;
+    // since statsInit
+    long long frames;
+    long long steps;
+    // after the last frame
+    int grains;
+    // chunks written during the last frame, out of chunks
+    int activeChunks;
+    int chunks;
+    // epoch the last frame ended in
+    uint32_t since;
+} stats_t;
+
+void statsInit(stats_t* s, world_t* w);
+// a frame that ran steps updates of w, in seconds for each part and in all since the
+// frame before
+void statsFrame(stats_t* s, world_t* w, int steps, double stepSeconds, double brushSeconds, double renderSeconds,
+                double frameSeconds);
+// the frame time in ms that a fraction p of the kept frames took at most, 0 with none
+double statsPercentile(const stats_t* s, double p);
+// the counters on one line
+void statsPrint(const stats_t* s, FILE* out);
+// the counters and a graph of the kept frame times, into a top-down 0x00RRGGBB image
+// with its top left corner at (x, y). clipped to the image
+void statsDraw(const stats_t* s, uint32_t* pixels, int width, int height, int x, int y);
+
+#endif
@@ -0,0 +1,90 @@
+// body of the sentinel step kernel, included by sim.c once per size it is stamped out for.
+// define STEP_KERNEL to the function name and STEP_WIDTH/STEP_HEIGHT to the world size,
+// or to 0 to read the size from the world. with fixed sizes every row offset and column
+// index below is a constant multiple the compiler can fold
+
+static int STEP_KERNEL(world_t* w, int rowLo, int rowHi) {
+    const int width = STEP_WIDTH ? STEP_WIDTH : w->width;
+    const int height = STEP_HEIGHT ? STEP_HEIGHT : w->height;
+    const int stride = width + 2;
+    const int words = STEP_HEIGHT ? (STEP_HEIGHT + 64) / 64 : w->columnWords;
+    const bool track = w->trackSurface;
+    // cell (0, 0), past the border
+    particle_t* cells = w->cells + stride + 1;
+    uint64_t* occupancy = w->occupancy;
+    int* surface = w->surface;
+    uint32_t* stamps = w->chunkStamp;
+    const int chunksX = w->chunksX;
+    const uint32_t epoch = w->epoch;
+
+    int moved = 0;
+    for (int i = rowHi - 1; i >= rowLo; --i) {
+        particle_t* row = cells + i * stride;
+        particle_t* below = row + stride;
+        for (int j = 0; j < width; ++j) {
+            if (!row[j].e) continue;
+            particle_t p = row[j];
+
+            int ny, nx;
+            if (!below[j].e) {
+                // free fall, speeding up until something stops it. the floor bit
+                // stops the search at the bottom of the world
+                int distance = fallDistance(p.v);
+                ny = scanColumn(occupancy + j * words, i, i + distance) - 1;
+                nx = j;
+                if (ny - i < distance) {
+                    p.v = 0;
+                } else if (distance < MAX_FALL) {
+                    p.v += GRAVITY;
+                }
+            } else {
+                // the border keeps these from sliding off the sides
+                bool rightPossible = !below[j + 1].e;
+                bool leftPossible = !below[j - 1].e;
+                if (rightPossible && leftPossible) {
+                    nx = cellRandom(w, i, j) & 1 ? j + 1 : j - 1;
+                } else if (rightPossible) {
+                    nx = j + 1;
+                } else if (leftPossible) {
+                    nx = j - 1;
+                } else {
+                    if (p.v) {
+                        int c = (i >> CHUNK_SHIFT) * chunksX + (j >> CHUNK_SHIFT);
+                        if (stamps[c] != epoch) stampChunk(w, c);
+                        row[j].v = 0;
+                    }
+                    continue;
+                }
+                ny = i + 1;
+                p.v = 0;
+            }
+
+            // stamped before the writes, see touchChunk()
+            int fromChunk = (i >> CHUNK_SHIFT) * chunksX + (j >> CHUNK_SHIFT);
+            int toChunk = (ny >> CHUNK_SHIFT) * chunksX + (nx >> CHUNK_SHIFT);
+            if (stamps[fromChunk] != epoch) stampChunk(w, fromChunk);
+            if (stamps[toChunk] != epoch) stampChunk(w, toChunk);
+
+            row[j] = EMPTY;
+            cells[ny * stride + nx] = p;
+            uint64_t* from = occupancy + j * words;
+            uint64_t* to = occupancy + nx * words;
+            from[i >> 6] &= ~((uint64_t) 1 << (i & 63));
+            to[ny >> 6] |= (uint64_t) 1 << (ny & 63);
+            if (fromChunk != toChunk) {
+                addToChunk(w, i >> CHUNK_SHIFT, j >> CHUNK_SHIFT, -1);
+                addToChunk(w, ny >> CHUNK_SHIFT, nx >> CHUNK_SHIFT, 1);
+            }
+            if (track) {
+                if (ny < surface[nx]) surface[nx] = ny;
+                if (i == surface[j]) surface[j] = scanColumn(from, i, height);
+            }
+            moved++;
+        }
+    }
+    return moved;
+}
+
+#undef STEP_KERNEL
+#undef STEP_WIDTH
+#undef STEP_HEIGHT
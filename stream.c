@@ -0,0 +1,196 @@
+#include "stream.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+void bufferPut(buffer_t* b, const void* data, size_t size) {
+    if (b->size + size > b->capacity) {
+        size_t capacity = b->capacity ? b->capacity : 4096;
+        while (capacity < b->size + size) capacity *= 2;
+        b->data = realloc(b->data, capacity);
+        b->capacity = capacity;
+    }
+    memcpy(b->data + b->size, data, size);
+    b->size += size;
+}
+
+void bufferFree(buffer_t* b) {
+    free(b->data);
+    memset(b, 0, sizeof(*b));
+}
+
+static void putU32(uint8_t* p, uint32_t v) {
+    for (int k = 0; k < 4; k++) p[k] = (uint8_t) (v >> (8 * k));
+}
+
+static uint32_t getU32(const uint8_t* p) {
+    return p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+void putVarint(buffer_t* b, uint32_t v) {
+    uint8_t bytes[5];
+    int n = 0;
+    while (v >= 0x80) {
+        bytes[n++] = (uint8_t) (v | 0x80);
+        v >>= 7;
+    }
+    bytes[n++] = (uint8_t) v;
+    bufferPut(b, bytes, n);
+}
+
+bool getVarint(const uint8_t** p, const uint8_t* end, uint32_t* v) {
+    *v = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (*p >= end) return false;
+        uint8_t byte = *(*p)++;
+        *v |= (uint32_t) (byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+static void encodeChunk(const world_t* w, int chunk, buffer_t* out) {
+    int x0, y0, x1, y1;
+    chunkBounds(w->width, w->height, chunk, &x0, &y0, &x1, &y1);
+    putVarint(out, chunk);
+
+    uint32_t value = packCell(w->cells[cellIndex(w, y0, x0)]);
+    uint32_t run = 0;
+    for (int i = y0; i < y1; i++) {
+        const particle_t* row = &w->cells[cellIndex(w, i, 0)];
+        for (int j = x0; j < x1; j++) {
+            uint32_t cell = packCell(row[j]);
+            if (cell != value) {
+                uint8_t bytes[4];
+                putVarint(out, run);
+                putU32(bytes, value);
+                bufferPut(out, bytes, 4);
+                value = cell;
+                run = 0;
+            }
+            run++;
+        }
+    }
+    uint8_t bytes[4];
+    putVarint(out, run);
+    putU32(bytes, value);
+    bufferPut(out, bytes, 4);
+}
+
+static void encodeFrame(const world_t* w, uint32_t type, uint32_t since, bool hashed, buffer_t* out) {
+    size_t start = out->size;
+    uint8_t header[FRAME_HEADER_SIZE] = { 0 };
+    bufferPut(out, header, sizeof(header));
+
+    uint32_t chunks = 0;
+    for (int c = 0; c < w->chunksX * w->chunksY; c++) {
+        if (type == FRAME_DELTA && w->chunkStamp[c] <= since) continue;
+        encodeChunk(w, c, out);
+        chunks++;
+    }
+
+    uint8_t* h = out->data + start;
+    uint64_t hash = hashed ? hashWorld(w) : 0;
+    putU32(h, FRAME_MAGIC);
+    putU32(h + 4, hashed ? type | FRAME_HASHED : type);
+    putU32(h + 8, w->step);
+    putU32(h + 12, w->width);
+    putU32(h + 16, w->height);
+    putU32(h + 20, chunks);
+    putU32(h + 24, (uint32_t) hash);
+    putU32(h + 28, (uint32_t) (hash >> 32));
+    putU32(h + 32, (uint32_t) (out->size - start - FRAME_HEADER_SIZE));
+}
+
+void encodeKeyframe(const world_t* w, buffer_t* out) {
+    encodeFrame(w, FRAME_KEY, 0, true, out);
+}
+
+void encodeDelta(const world_t* w, uint32_t since, bool hashed, buffer_t* out) {
+    encodeFrame(w, FRAME_DELTA, since, hashed, out);
+}
+
+bool readFrameHeader(const uint8_t* data, frame_header_t* header) {
+    if (getU32(data) != FRAME_MAGIC) return false;
+    header->type = getU32(data + 4) & ~FRAME_HASHED;
+    header->hashed = (getU32(data + 4) & FRAME_HASHED) != 0;
+    header->step = getU32(data + 8);
+    header->width = getU32(data + 12);
+    header->height = getU32(data + 16);
+    header->chunks = getU32(data + 20);
+    header->hash = getU32(data + 24) | (uint64_t) getU32(data + 28) << 32;
+    header->bytes = getU32(data + 32);
+    return header->type == FRAME_KEY || header->type == FRAME_DELTA;
+}
+
+bool applyFrame(view_t* v, const frame_header_t* header, const uint8_t* payload) {
+    if (header->type == FRAME_KEY) {
+        // the size comes from the peer, so it's checked before anything is allocated for it
+        if (header->width == 0 || header->height == 0 || header->width > FRAME_MAX_SIDE
+            || header->height > FRAME_MAX_SIDE) {
+            return false;
+        }
+        size_t cells = (size_t) header->width * header->height;
+        if (cells > SIZE_MAX / sizeof(uint32_t)) return false;
+        if ((int) header->width != v->width || (int) header->height != v->height) {
+            free(v->cells);
+            v->cells = malloc(cells * sizeof(uint32_t));
+            v->width = v->cells ? (int) header->width : 0;
+            v->height = v->cells ? (int) header->height : 0;
+            if (!v->cells) return false;
+        }
+    } else if (!v->cells || (int) header->width != v->width || (int) header->height != v->height) {
+        // a delta only makes sense on top of a keyframe of the same world
+        return false;
+    }
+
+    const uint8_t* p = payload;
+    const uint8_t* end = payload + header->bytes;
+    int chunksX = (v->width + CHUNK_SIZE - 1) >> CHUNK_SHIFT;
+    int chunkCount = chunksX * ((v->height + CHUNK_SIZE - 1) >> CHUNK_SHIFT);
+    for (uint32_t k = 0; k < header->chunks; k++) {
+        uint32_t chunk;
+        if (!getVarint(&p, end, &chunk) || (int) chunk >= chunkCount) return false;
+        int x0, y0, x1, y1;
+        chunkBounds(v->width, v->height, (int) chunk, &x0, &y0, &x1, &y1);
+
+        // fill the chunk row by row from its runs
+        int i = y0, j = x0;
+        while (i < y1) {
+            uint32_t run;
+            if (!getVarint(&p, end, &run) || end - p < 4) return false;
+            uint32_t value = getU32(p);
+            p += 4;
+            for (; run > 0; run--) {
+                if (i >= y1) return false;
+                v->cells[i * v->width + j] = value;
+                if (++j == x1) {
+                    j = x0;
+                    i++;
+                }
+            }
+        }
+    }
+    v->step = header->step;
+    return p == end;
+}
+
+uint64_t hashView(const view_t* v) {
+    // must match hashWorld(): FNV-1a over (index, color) of every filled cell
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (int i = 0; i < v->width * v->height; i++) {
+        if (!v->cells[i]) continue;
+        uint32_t words[2] = { (uint32_t) i, v->cells[i] & 0xFFFFFF };
+        const uint8_t* bytes = (const uint8_t*) words;
+        for (int k = 0; k < 8; k++) {
+            h = (h ^ bytes[k]) * 0x100000001b3ull;
+        }
+    }
+    return h;
+}
+
+void viewFree(view_t* v) {
+    free(v->cells);
+    v->cells = NULL;
+}
@@ -0,0 +1,82 @@
+#ifndef SANDSIM_STREAM_H
+#define SANDSIM_STREAM_H
+
+#include <stddef.h>
+
+#include "sim.h"
+
+// world frames as sent to spectators. every frame is a fixed header followed by
+// chunk records: a varint chunk index, then the chunk's cells row by row as
+// runs of (varint length, 32 bit cell). a keyframe holds every chunk, a delta
+// only those written since the previous frame. hashing the world is a pass over all
+// of it, so keyframes carry the hash and deltas only when the server asks for it
+#define FRAME_MAGIC 0x444E4153u
+#define FRAME_HEADER_SIZE 36
+// bit set in the type on the wire when the hash was taken
+#define FRAME_HASHED 0x100u
+// deltas a server sends per hashed one
+#define FRAME_HASH_EVERY 64
+// the largest width or height a spectator takes from a keyframe
+#define FRAME_MAX_SIDE 32768
+
+enum { FRAME_KEY = 1, FRAME_DELTA = 2 };
+
+typedef struct frame_header {
+    uint32_t type;
+    // updates done when the frame was taken
+    uint32_t step;
+    uint32_t width;
+    uint32_t height;
+    // chunk records that follow
+    uint32_t chunks;
+    // whether hash was taken
+    bool hashed;
+    // hashWorld() of the world the frame describes, 0 when not hashed
+    uint64_t hash;
+    // bytes after the header
+    uint32_t bytes;
+} frame_header_t;
+
+// growable byte buffer
+typedef struct buffer {
+    uint8_t* data;
+    size_t size;
+    size_t capacity;
+} buffer_t;
+
+void bufferPut(buffer_t* b, const void* data, size_t size);
+void bufferFree(buffer_t* b);
+// appends v 7 bits at a time, low bits first, the top bit set on all but the last byte
+void putVarint(buffer_t* b, uint32_t v);
+// reads a varint at *p and moves *p past it. false if it runs past end
+bool getVarint(const uint8_t** p, const uint8_t* end, uint32_t* v);
+
+// a cell as it goes over the wire, 0 for empty, color plus bit 24 for a grain
+static inline uint32_t packCell(particle_t p) {
+    return p.e ? (p.c & 0xFFFFFF) | 0x1000000 : 0;
+}
+
+// appends a frame with every chunk of w
+void encodeKeyframe(const world_t* w, buffer_t* out);
+// appends a frame with the chunks of w stamped after epoch since, with the world's
+// hash if hashed
+void encodeDelta(const world_t* w, uint32_t since, bool hashed, buffer_t* out);
+
+bool readFrameHeader(const uint8_t* data, frame_header_t* header);
+
+// what a spectator rebuilds from frames, packed cells row by row
+typedef struct view {
+    int width;
+    int height;
+    uint32_t step;
+    uint32_t* cells;
+} view_t;
+
+// applies a frame's records to v, taking the size from keyframes. false if the frame is
+// malformed, its size is out of range or the cells can't be allocated
+bool applyFrame(view_t* v, const frame_header_t* header, const uint8_t* payload);
+// same value as hashWorld() on the world the view mirrors
+uint64_t hashView(const view_t* v);
+void viewFree(view_t* v);
+
+#endif
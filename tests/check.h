@@ -0,0 +1,52 @@
+#ifndef SANDSIM_TESTS_CHECK_H
+#define SANDSIM_TESTS_CHECK_H
+
+#include <stdio.h>
+
+#include "sim.h"
+
+// what every test shares: a failure count, a check that reports where it failed and
+// carries on, and a check of a world's bookkeeping against its cells
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        failures++; \
+        printf("  FAIL %s:%d: ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+    } \
+} while (0)
+
+// what main returns, with the failures counted if there were any
+static inline int checkResult() {
+    if (failures) printf("%d failures\n", failures);
+    return failures ? 1 : 0;
+}
+
+// chunk counts, occupancy bits and surfaces agree with the cells
+static inline bool consistent(const world_t* w) {
+    int total = 0;
+    for (int c = 0; c < w->chunksX * w->chunksY; c++) {
+        int x0, y0, x1, y1, count = 0;
+        chunkBounds(w->width, w->height, c, &x0, &y0, &x1, &y1);
+        for (int i = y0; i < y1; i++) {
+            for (int j = x0; j < x1; j++) count += at(w, i, j).e;
+        }
+        if (w->chunkGrains[c] != count) return false;
+        total += count;
+    }
+    for (int j = 0; j < w->width; j++) {
+        int top = w->height;
+        for (int i = w->height - 1; i >= 0; i--) {
+            bool filled = (w->occupancy[j * w->columnWords + (i >> 6)] >> (i & 63)) & 1;
+            if (filled != at(w, i, j).e) return false;
+            if (filled) top = i;
+        }
+        if (w->trackSurface && w->surface[j] != top) return false;
+    }
+    return countGrains(w) == total;
+}
+
+#endif
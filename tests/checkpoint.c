@@ -0,0 +1,123 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "check.h"
+#include "checkpoint.h"
+#include "sim.h"
+
+// checkpoints taken while the world keeps updating must hold the world as it was
+// when they began, and a world loaded from one must carry on exactly like the original
+
+static const char* PATH = "sandsim_test.checkpoint";
+
+static void noise(world_t* w, int percent) {
+    unsigned state = w->seed;
+    for (int i = 0; i < w->height / 2; i++) {
+        for (int j = 0; j < w->width; j++) {
+            state = state * 1664525u + 1013904223u;
+            if ((state >> 8) % 100 < (unsigned) percent) {
+                set(w, i, j, (particle_t) { RGB(j, i, i ^ j), true, false, 0 });
+            }
+        }
+    }
+}
+
+// pouring depends on the gradient state, which a checkpoint has to bring back too
+static void advance(world_t* w) {
+    if (w->step < 150) pour(w, 6);
+    UpdateGrid(w);
+}
+
+// checkpoint every few updates of a running world, then check each file against the
+// world it was taken of and run the reloaded world on to where the original ended up
+static void checkRunning(int width, int height, int steps, int every) {
+    world_t w;
+    worldInit(&w, width, height, 77);
+    noise(&w, 30);
+
+    enum { MAX_SAVES = 64 };
+    uint64_t hashes[MAX_SAVES];
+    uint32_t saveSteps[MAX_SAVES];
+    int saves = 0, copied = 0;
+    char path[64];
+    for (int s = 0; s < steps; s++) {
+        if (w.checkpoint && !checkpointBusy(&w)) {
+            int n = checkpointEnd(&w);
+            CHECK(n >= 0, "%dx%d: checkpoint %d failed", width, height, saves - 1);
+            copied += n;
+        }
+        if (s % every == 0 && !w.checkpoint && saves < MAX_SAVES) {
+            snprintf(path, sizeof(path), "%s.%d", PATH, saves);
+            hashes[saves] = hashWorld(&w);
+            saveSteps[saves] = w.step;
+            CHECK(checkpointBegin(&w, path), "%dx%d: can't begin a checkpoint", width, height);
+            saves++;
+        }
+        advance(&w);
+    }
+    if (w.checkpoint) copied += checkpointEnd(&w);
+
+    for (int k = 0; k < saves; k++) {
+        snprintf(path, sizeof(path), "%s.%d", PATH, k);
+        world_t loaded;
+        bool ok = checkpointLoad(&loaded, path);
+        CHECK(ok, "%dx%d: can't load checkpoint %d", width, height, k);
+        remove(path);
+        if (!ok) continue;
+        CHECK(loaded.step == saveSteps[k], "%dx%d: checkpoint %d is of update %u, expected %u", width, height, k,
+              loaded.step, saveSteps[k]);
+        CHECK(hashWorld(&loaded) == hashes[k], "%dx%d: checkpoint %d differs from the world it was taken of",
+              width, height, k);
+        while (loaded.step < w.step) {
+            advance(&loaded);
+        }
+        CHECK(hashWorld(&loaded) == hashWorld(&w), "%dx%d: world resumed from checkpoint %d drifted",
+              width, height, k);
+        worldFree(&loaded);
+    }
+    printf("%4dx%-4d %2d checkpoints, %d chunks copied\n", width, height, saves, copied);
+    worldFree(&w);
+}
+
+// clearing the world right after a checkpoint begins writes every chunk, nearly
+// all of them before the writer gets to them
+static void checkCleared() {
+    world_t w;
+    worldInit(&w, 300, 200, 5);
+    noise(&w, 60);
+    uint64_t hash = hashWorld(&w);
+    CHECK(checkpointBegin(&w, PATH), "can't begin a checkpoint");
+    CHECK(!checkpointBegin(&w, PATH), "a second checkpoint began while one was running");
+    worldClear(&w);
+    int copied = checkpointEnd(&w);
+    CHECK(copied >= 0, "checkpoint of a cleared world failed");
+    CHECK(countGrains(&w) == 0, "world not cleared");
+
+    world_t loaded;
+    bool ok = checkpointLoad(&loaded, PATH);
+    CHECK(ok && hashWorld(&loaded) == hash, "checkpoint doesn't hold the world from before the clear");
+    if (ok) worldFree(&loaded);
+    remove(PATH);
+    printf("cleared   %d chunks copied\n", copied);
+    worldFree(&w);
+}
+
+static void checkBadFile() {
+    FILE* file = fopen(PATH, "wb");
+    fputs("not a checkpoint", file);
+    fclose(file);
+    world_t w;
+    CHECK(!checkpointLoad(&w, PATH), "loaded a file that isn't a checkpoint");
+    CHECK(!checkpointLoad(&w, "no such file"), "loaded a missing file");
+    remove(PATH);
+}
+
+int main() {
+    checkRunning(128, 128, 200, 7);
+    checkRunning(97, 131, 200, 13);
+    checkRunning(1024, 1024, 120, 10);
+    checkCleared();
+    checkBadFile();
+    return checkResult();
+}
@@ -0,0 +1,384 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "check.h"
+#include "sim.h"
+
+#ifdef _WIN32
+static double now() {
+    LARGE_INTEGER count, frequency;
+    QueryPerformanceCounter(&count);
+    QueryPerformanceFrequency(&frequency);
+    return (double) count.QuadPart / frequency.QuadPart;
+}
+#else
+#include <time.h>
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+#endif
+
+// runs every step kernel against the reference kernel on the same scenes and
+// fails on the first update where a kernel's world differs from the reference's
+
+// a scene fills an empty world and may add grains before any update
+typedef struct scene {
+    const char* name;
+    int width;
+    int height;
+    int steps;
+    void (*setup)(world_t* w);
+    // called before every update, may be NULL
+    void (*feed)(world_t* w, int step);
+} scene_t;
+
+static particle_t grain(int y, int x) {
+    return (particle_t) { RGB(x * 7, y * 13, x ^ y), true, false, 0 };
+}
+
+static unsigned random32(unsigned* state) {
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+static void noise(world_t* w, int percent) {
+    unsigned state = w->seed;
+    for (int i = 0; i < w->height; i++) {
+        for (int j = 0; j < w->width; j++) {
+            if (random32(&state) % 100 < (unsigned) percent) set(w, i, j, grain(i, j));
+        }
+    }
+}
+
+static void noiseSparse(world_t* w) { noise(w, 5); }
+static void noiseHalf(world_t* w) { noise(w, 50); }
+static void noiseDense(world_t* w) { noise(w, 90); }
+static void full(world_t* w) { noise(w, 100); }
+static void nothing(world_t* w) { (void) w; }
+
+static void singleGrain(world_t* w) {
+    set(w, 0, w->width / 2, grain(0, w->width / 2));
+}
+
+static void column(world_t* w) {
+    for (int i = 0; i < w->height / 2; i++) {
+        set(w, i, w->width / 2, grain(i, w->width / 2));
+    }
+}
+
+// grains hugging both side walls, which must not slide through them
+static void edges(world_t* w) {
+    for (int i = 0; i < w->height; i += 2) {
+        set(w, i, 0, grain(i, 0));
+        set(w, i, w->width - 1, grain(i, w->width - 1));
+    }
+}
+
+// a solid block over empty space collapses all at once
+static void tower(world_t* w) {
+    int x0 = w->width / 3, x1 = 2 * w->width / 3;
+    for (int i = 0; i < w->height / 2; i++) {
+        for (int j = x0; j < x1; j++) set(w, i, j, grain(i, j));
+    }
+}
+
+static void pourFeed(world_t* w, int step) {
+    if (step < 200) pour(w, 6);
+}
+
+static void rainFeed(world_t* w, int step) {
+    unsigned state = w->seed + step * 7919u;
+    for (int k = 0; k < 16; k++) {
+        int j = random32(&state) % w->width;
+        set(w, 0, j, grain(step, j));
+    }
+}
+
+static const scene_t SCENES[] = {
+    { "single grain", 64, 300, 320, singleGrain, NULL },
+    { "column", 33, 200, 200, column, NULL },
+    { "edges", 16, 64, 100, edges, NULL },
+    { "tower", 128, 128, 300, tower, NULL },
+    { "full", 40, 40, 10, full, NULL },
+    { "1x1", 1, 1, 5, full, NULL },
+    { "1 wide", 1, 70, 80, noiseHalf, NULL },
+    { "1 tall", 70, 1, 5, noiseHalf, NULL },
+    { "sparse 128", 128, 128, 250, noiseSparse, NULL },
+    { "half 100x150", 100, 150, 250, noiseHalf, NULL },
+    { "dense 256", 256, 256, 150, noiseDense, NULL },
+    { "pour 200", 200, 200, 400, nothing, pourFeed },
+    { "rain 97x131", 97, 131, 300, nothing, rainFeed },
+};
+static const int SCENE_COUNT = sizeof(SCENES) / sizeof(SCENES[0]);
+
+static const kernel_info_t* referenceKernel() {
+    for (int k = 0; k < KERNEL_COUNT; k++) {
+        if (strcmp(KERNELS[k].name, "reference") == 0) return &KERNELS[k];
+    }
+    return NULL;
+}
+
+// lift runs the kernel with falling grains lifted out of the grid, worklist steps only
+// the grains on the active list instead
+static void runScene(const scene_t* scene, const kernel_info_t* kernel, const kernel_info_t* reference, bool lift,
+                     bool worklist) {
+    world_t expected, actual;
+    uint32_t seed = 1234567u + scene->width * 31u + scene->height;
+    worldInit(&expected, scene->width, scene->height, seed);
+    worldInit(&actual, scene->width, scene->height, seed);
+    actual.kernel = kernel->step;
+    actual.liftAirborne = lift;
+    actual.worklist = worklist;
+    scene->setup(&expected);
+    scene->setup(&actual);
+
+    int grains = countGrains(&expected);
+    for (int s = 0; s < scene->steps; s++) {
+        if (scene->feed) {
+            scene->feed(&expected, s);
+            scene->feed(&actual, s);
+            grains = countGrains(&expected);
+        }
+        int movedExpected = reference->step(&expected, 0, expected.height);
+        expected.step++;
+        int movedActual = UpdateGrid(&actual);
+
+        int count = countGrains(&actual);
+        uint64_t hashExpected = hashWorld(&expected);
+        uint64_t hashActual = hashWorld(&actual);
+        CHECK(count == grains, "%s / %s: %d grains after update %d, expected %d",
+              scene->name, kernel->name, count, s, grains);
+        CHECK(movedActual == movedExpected, "%s / %s: %d grains moved on update %d, expected %d",
+              scene->name, kernel->name, movedActual, s, movedExpected);
+        CHECK(hashActual == hashExpected, "%s / %s: world differs after update %d",
+              scene->name, kernel->name, s);
+        CHECK(consistent(&actual), "%s / %s: bookkeeping out of sync after update %d",
+              scene->name, kernel->name, s);
+        if (count != grains || hashActual != hashExpected || movedActual != movedExpected) break;
+    }
+
+    worldFree(&expected);
+    worldFree(&actual);
+}
+
+// the scene advanced passes of steps updates at a time by UpdateGridBlocked(), with a
+// cache just big enough for a pass of MAX_FALL row bands
+static void runBlocked(const scene_t* scene, const kernel_info_t* reference, int steps) {
+    world_t expected, actual;
+    uint32_t seed = 1234567u + scene->width * 31u + scene->height;
+    worldInit(&expected, scene->width, scene->height, seed);
+    worldInit(&actual, scene->width, scene->height, seed);
+    scene->setup(&expected);
+    scene->setup(&actual);
+    long cache = (long) (steps + 1) * MAX_FALL * actual.stride * sizeof(particle_t);
+
+    for (int s = 0; s < scene->steps; s += steps) {
+        if (scene->feed) {
+            scene->feed(&expected, s);
+            scene->feed(&actual, s);
+        }
+        int movedExpected = 0;
+        for (int k = 0; k < steps; k++) {
+            movedExpected += reference->step(&expected, 0, expected.height);
+            expected.step++;
+        }
+        int movedActual = UpdateGridBlocked(&actual, steps, cache);
+        bool same = hashWorld(&actual) == hashWorld(&expected) && movedActual == movedExpected;
+        CHECK(same, "%s / %d per pass: world differs after update %d", scene->name, steps, s + steps - 1);
+        CHECK(consistent(&actual), "%s / %d per pass: bookkeeping out of sync after update %d",
+              scene->name, steps, s + steps - 1);
+        if (!same) break;
+    }
+
+    worldFree(&expected);
+    worldFree(&actual);
+}
+
+// the worklist picked up again after updates that didn't keep it, and after clearing
+static void checkWorklistHandover() {
+    world_t expected, actual;
+    worldInit(&expected, 97, 131, 5);
+    worldInit(&actual, 97, 131, 5);
+    actual.worklist = true;
+    for (int s = 0; s < 300; s++) {
+        if (s == 150) {
+            worldClear(&expected);
+            worldClear(&actual);
+        }
+        rainFeed(&expected, s);
+        rainFeed(&actual, s);
+        UpdateGrid(&expected);
+        if (s % 7 == 3) {
+            UpdateBand(&actual, actual.height);
+        } else {
+            UpdateGrid(&actual);
+        }
+        CHECK(hashWorld(&actual) == hashWorld(&expected), "worklist world differs after update %d", s);
+        if (hashWorld(&actual) != hashWorld(&expected)) break;
+    }
+    worldFree(&expected);
+    worldFree(&actual);
+}
+
+// a grain dropped from the top has to end up on the floor
+static void checkLanding() {
+    world_t w;
+    worldInit(&w, 8, 4096, 1);
+    set(&w, 0, 3, grain(0, 3));
+    int s = 0;
+    while (s < 4096 && !at(&w, 4095, 3).e) {
+        UpdateGrid(&w);
+        s++;
+    }
+    CHECK(at(&w, 4095, 3).e, "grain never reached the floor of a 4096 tall world");
+    CHECK(s < 256, "grain took %d updates to fall 4096 rows", s);
+    worldFree(&w);
+}
+
+// rectangle and column counts against counting the cells one by one, on worlds
+// changed by set(), by updates and by clearing
+static void checkRegionCounts() {
+    static const int SIZES[][2] = { { 1, 1 }, { 31, 33 }, { 64, 64 }, { 100, 150 }, { 257, 129 } };
+    unsigned state = 42;
+    for (int s = 0; s < 5; s++) {
+        world_t w;
+        worldInit(&w, SIZES[s][0], SIZES[s][1], 7);
+        noise(&w, 40);
+        for (int round = 0; round < 3; round++) {
+            for (int q = 0; q < 200; q++) {
+                int y0 = (int) (random32(&state) % (w.height + 10)) - 5;
+                int x0 = (int) (random32(&state) % (w.width + 10)) - 5;
+                int y1 = y0 + (int) (random32(&state) % (w.height + 5));
+                int x1 = x0 + (int) (random32(&state) % (w.width + 5));
+                int expected = 0;
+                for (int i = y0; i < y1; i++) {
+                    for (int j = x0; j < x1; j++) expected += at(&w, i, j).e;
+                }
+                int count = countRect(&w, y0, x0, y1, x1);
+                CHECK(count == expected, "%dx%d: %d grains in [%d, %d) x [%d, %d), expected %d",
+                      w.width, w.height, count, y0, y1, x0, x1, expected);
+                if (count != expected) break;
+            }
+            for (int j = 0; j < w.width; j++) {
+                int expected = 0;
+                for (int i = 0; i < w.height; i++) expected += at(&w, i, j).e;
+                CHECK(columnGrains(&w, j) == expected, "%dx%d: column %d has %d grains, expected %d",
+                      w.width, w.height, j, columnGrains(&w, j), expected);
+            }
+            CHECK(consistent(&w), "%dx%d: chunk counts out of sync", w.width, w.height);
+            for (int k = 0; k < 20; k++) UpdateGrid(&w);
+            rainFeed(&w, round);
+        }
+        worldClear(&w);
+        CHECK(countGrains(&w) == 0 && countRect(&w, 0, 0, w.height, w.width) == 0,
+              "%dx%d: grains left after clearing", w.width, w.height);
+        worldFree(&w);
+    }
+}
+
+static void conformance() {
+    const kernel_info_t* reference = referenceKernel();
+    CHECK(reference != NULL, "no reference kernel");
+    if (!reference) return;
+
+    for (int k = 0; k < KERNEL_COUNT; k++) {
+        const kernel_info_t* kernel = &KERNELS[k];
+        int before = failures;
+        int ran = 0;
+        for (int c = 0; c < SCENE_COUNT; c++) {
+            const scene_t* scene = &SCENES[c];
+            if (kernel->width && (kernel->width != scene->width || kernel->height != scene->height)) continue;
+            runScene(scene, kernel, reference, false, false);
+            ran++;
+        }
+        // size specialized kernels get a noise scene of their own size
+        if (kernel->width) {
+            scene_t own = { "own size", kernel->width, kernel->height, kernel->width <= 1024 ? 40 : 6, noiseHalf, NULL };
+            runScene(&own, kernel, reference, false, false);
+            ran++;
+        }
+        printf("%-16s %2d scenes %s\n", kernel->name, ran, failures == before ? "ok" : "FAILED");
+    }
+
+    // every scene again with falling grains stepped as a list, on the kernel each world picks
+    int before = failures;
+    for (int c = 0; c < SCENE_COUNT; c++) {
+        world_t probe;
+        worldInit(&probe, SCENES[c].width, SCENES[c].height, 0);
+        kernel_info_t picked = { "picked", 0, 0, probe.kernel };
+        worldFree(&probe);
+        runScene(&SCENES[c], &picked, reference, true, false);
+    }
+    printf("%-16s %2d scenes %s\n", "airborne", SCENE_COUNT, failures == before ? "ok" : "FAILED");
+
+    // and with only the grains on the active list stepped
+    before = failures;
+    for (int c = 0; c < SCENE_COUNT; c++) {
+        world_t probe;
+        worldInit(&probe, SCENES[c].width, SCENES[c].height, 0);
+        kernel_info_t picked = { "worklist", 0, 0, probe.kernel };
+        worldFree(&probe);
+        runScene(&SCENES[c], &picked, reference, false, true);
+    }
+    checkWorklistHandover();
+    printf("%-16s %2d scenes %s\n", "worklist", SCENE_COUNT, failures == before ? "ok" : "FAILED");
+
+    // and advanced several updates per pass over the world
+    static const int PASSES[] = { 1, 2, 3, 8 };
+    before = failures;
+    for (int p = 0; p < 4; p++) {
+        for (int c = 0; c < SCENE_COUNT; c++) runBlocked(&SCENES[c], reference, PASSES[p]);
+    }
+    printf("%-16s %2d scenes %s\n", "blocked", SCENE_COUNT, failures == before ? "ok" : "FAILED");
+    checkLanding();
+    before = failures;
+    checkRegionCounts();
+    printf("%-16s %2s        %s\n", "region counts", "", failures == before ? "ok" : "FAILED");
+}
+
+// ns per cell per update for every kernel at a few sizes
+static void microbench() {
+    static const int SIZES[] = { 128, 256, 512, 1024 };
+    printf("%-16s", "ns/cell");
+    for (int s = 0; s < 4; s++) printf(" %9d", SIZES[s]);
+    printf("\n");
+
+    for (int k = 0; k < KERNEL_COUNT; k++) {
+        const kernel_info_t* kernel = &KERNELS[k];
+        printf("%-16s", kernel->name);
+        for (int s = 0; s < 4; s++) {
+            int n = SIZES[s];
+            if (kernel->width && (kernel->width != n || kernel->height != n)) {
+                printf(" %9s", "-");
+                continue;
+            }
+            world_t w;
+            worldInit(&w, n, n, 99);
+            w.kernel = kernel->step;
+            noise(&w, 30);
+            int steps = (1 << 24) / (n * n) + 4;
+            double start = now();
+            for (int i = 0; i < steps; i++) {
+                UpdateGrid(&w);
+            }
+            double elapsed = now() - start;
+            printf(" %9.3f", elapsed / ((double) n * n * steps) * 1e9);
+            worldFree(&w);
+        }
+        printf("\n");
+    }
+}
+
+int main(int argc, char** argv) {
+    bool bench = argc > 1 && strcmp(argv[1], "--bench") == 0;
+    if (bench) {
+        microbench();
+    } else {
+        conformance();
+    }
+    return checkResult();
+}
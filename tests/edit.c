@@ -0,0 +1,227 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "check.h"
+#include "edit.h"
+#include "sim.h"
+
+// every bulk edit leaves the same world as set() on each of its cells would, with the
+// occupancy, surfaces, chunk counts, stamps and active list all kept up
+
+static particle_t grain(int y, int x) {
+    return (particle_t) { RGB(x, y, 7), true, false, 0 };
+}
+
+static const particle_t PAINT = { RGB(200, 100, 50), true, false, 0 };
+
+static bool sameCells(const world_t* a, const world_t* b) {
+    for (int i = 0; i < a->height; i++) {
+        for (int j = 0; j < a->width; j++) {
+            particle_t p = at(a, i, j), q = at(b, i, j);
+            if (p.e != q.e || (p.e && p.c != q.c)) return false;
+        }
+    }
+    return true;
+}
+
+// a half full world on the worklist, twice over
+static void makeWorlds(world_t* w, world_t* reference, int height, int width) {
+    worldInit(w, width, height, 4);
+    worldInit(reference, width, height, 4);
+    unsigned state = 12345;
+    for (int i = 0; i < height; i++) {
+        for (int j = 0; j < width; j++) {
+            state = state * 1664525u + 1013904223u;
+            if ((state >> 8) % 100 < 50) {
+                set(w, i, j, grain(i, j));
+                set(reference, i, j, grain(i, j));
+            }
+        }
+    }
+    w->worklist = true;
+    reference->worklist = true;
+    UpdateGrid(w);
+    UpdateGrid(reference);
+}
+
+// the edited world matches the one set() cell by cell, and updates the same from it
+static void compare(world_t* w, world_t* reference, int changed, int expected, const char* what) {
+    CHECK(changed == expected, "%s changed %d cells, expected %d", what, changed, expected);
+    CHECK(sameCells(w, reference), "%s: cells differ from set()", what);
+    CHECK(consistent(w), "%s: bookkeeping out of sync", what);
+    for (int k = 0; k < 30; k++) {
+        UpdateGrid(w);
+        UpdateGrid(reference);
+    }
+    CHECK(hashWorld(w) == hashWorld(reference), "%s: world updated differently after the edit", what);
+}
+
+// set() at (y, x) counting a change between empty and filled
+static int setCounted(world_t* w, int y, int x, particle_t p) {
+    if (!inRange(w, y, x)) return 0;
+    int changed = at(w, y, x).e != p.e;
+    set(w, y, x, p);
+    return changed;
+}
+
+static void checkRect() {
+    static const int RECTS[][4] = { { 5, 7, 60, 90 }, { -10, -10, 300, 300 }, { 40, 33, 41, 34 },
+                                    { 31, 31, 33, 97 }, { 70, 10, 200, 20 }, { 10, 10, 10, 50 } };
+    for (int r = 0; r < 6; r++) {
+        for (int fill = 0; fill < 2; fill++) {
+            world_t w, reference;
+            makeWorlds(&w, &reference, 100, 130);
+            particle_t p = fill ? PAINT : EMPTY;
+            const int* q = RECTS[r];
+            uint32_t since = nextEpoch(&w);
+            int changed = setRect(&w, q[0], q[1], q[2], q[3], p);
+            int expected = 0;
+            for (int i = q[0]; i < q[2]; i++) {
+                for (int j = q[1]; j < q[3]; j++) expected += setCounted(&reference, i, j, p);
+            }
+            bool stamped = true;
+            for (int i = q[0] > 0 ? q[0] : 0; i < q[2] && i < 100; i++) {
+                for (int j = q[1] > 0 ? q[1] : 0; j < q[3] && j < 130; j++) {
+                    stamped = stamped && w.chunkStamp[(i >> CHUNK_SHIFT) * w.chunksX + (j >> CHUNK_SHIFT)] > since;
+                }
+            }
+            CHECK(stamped, "rect %d: a chunk written to wasn't stamped", r);
+            char what[32];
+            snprintf(what, sizeof(what), "%s rect %d", fill ? "fill" : "erase", r);
+            compare(&w, &reference, changed, expected, what);
+            worldFree(&w);
+            worldFree(&reference);
+        }
+    }
+}
+
+static void checkCircle() {
+    static const int CIRCLES[][3] = { { 50, 60, 1 }, { 50, 60, 20 }, { 0, 0, 30 }, { 95, 125, 70 } };
+    for (int c = 0; c < 4; c++) {
+        for (int fill = 0; fill < 2; fill++) {
+            world_t w, reference;
+            makeWorlds(&w, &reference, 100, 130);
+            particle_t p = fill ? PAINT : EMPTY;
+            int y = CIRCLES[c][0], x = CIRCLES[c][1], r = CIRCLES[c][2];
+            int changed = fillCircle(&w, y, x, r, p);
+            int expected = 0;
+            for (int i = y - r; i <= y + r; i++) {
+                for (int j = x - r; j <= x + r; j++) {
+                    if ((i - y) * (i - y) + (j - x) * (j - x) < r * r) expected += setCounted(&reference, i, j, p);
+                }
+            }
+            char what[32];
+            snprintf(what, sizeof(what), "%s circle %d", fill ? "fill" : "erase", c);
+            compare(&w, &reference, changed, expected, what);
+            worldFree(&w);
+            worldFree(&reference);
+        }
+    }
+}
+
+// even-odd rule at cell centers, one edge at a time
+static bool insidePolygon(const vertex_t* v, int count, double y, double x) {
+    bool inside = false;
+    for (int i = 0; i < count; i++) {
+        vertex_t a = v[i], b = v[(i + 1) % count];
+        if ((a.y <= y) != (b.y <= y) && x < a.x + (y - a.y) * (b.x - a.x) / (b.y - a.y)) inside = !inside;
+    }
+    return inside;
+}
+
+static void checkPolygon() {
+    static const vertex_t TRIANGLE[] = { { 10, 10 }, { 80.5, 40.25 }, { 20, 120 } };
+    static const vertex_t STAR[] = { { 5, 65 }, { 90, 20 }, { 35, 120 }, { 35, 5 }, { 90, 110 } };
+    static const vertex_t OUTSIDE[] = { { -50, -50 }, { -50, 500 }, { 60, 500 }, { 60, -50 } };
+    static const vertex_t* POLYGONS[] = { TRIANGLE, STAR, OUTSIDE };
+    static const int COUNTS[] = { 3, 5, 4 };
+    for (int s = 0; s < 3; s++) {
+        for (int fill = 0; fill < 2; fill++) {
+            world_t w, reference;
+            makeWorlds(&w, &reference, 100, 130);
+            particle_t p = fill ? PAINT : EMPTY;
+            int changed = fillPolygon(&w, POLYGONS[s], COUNTS[s], p);
+            int expected = 0;
+            for (int i = 0; i < 100; i++) {
+                for (int j = 0; j < 130; j++) {
+                    if (insidePolygon(POLYGONS[s], COUNTS[s], i + 0.5, j + 0.5)) expected += setCounted(&reference, i, j, p);
+                }
+            }
+            char what[32];
+            snprintf(what, sizeof(what), "%s polygon %d", fill ? "fill" : "erase", s);
+            compare(&w, &reference, changed, expected, what);
+            worldFree(&w);
+            worldFree(&reference);
+        }
+    }
+}
+
+// a breadth first walk over the cells joined to (y, x), set one at a time
+static int floodReference(world_t* w, int y, int x, particle_t p) {
+    bool filled = at(w, y, x).e;
+    int cells = w->width * w->height;
+    bool* seen = calloc(cells, sizeof(bool));
+    int* queue = malloc(cells * sizeof(int));
+    int head = 0, tail = 0, changed = 0;
+    queue[tail++] = y * w->width + x;
+    seen[y * w->width + x] = true;
+    while (head < tail) {
+        int i = queue[head] / w->width, j = queue[head] % w->width;
+        head++;
+        static const int STEPS[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+        for (int k = 0; k < 4; k++) {
+            int ni = i + STEPS[k][0], nj = j + STEPS[k][1];
+            if (!inRange(w, ni, nj) || seen[ni * w->width + nj] || at(w, ni, nj).e != filled) continue;
+            seen[ni * w->width + nj] = true;
+            queue[tail++] = ni * w->width + nj;
+        }
+    }
+    for (int k = 0; k < tail; k++) changed += setCounted(w, queue[k] / w->width, queue[k] % w->width, p);
+    free(seen);
+    free(queue);
+    return changed;
+}
+
+static void checkFlood() {
+    static const int SEEDS[][2] = { { 0, 0 }, { 50, 64 }, { 99, 129 }, { 17, 3 } };
+    for (int s = 0; s < 4; s++) {
+        for (int fill = 0; fill < 2; fill++) {
+            world_t w, reference;
+            makeWorlds(&w, &reference, 100, 130);
+            // walls to make some caves
+            for (int i = 0; i < 90; i++) {
+                set(&w, i, 40, PAINT);
+                set(&reference, i, 40, PAINT);
+                set(&w, 99 - i, 90, PAINT);
+                set(&reference, 99 - i, 90, PAINT);
+            }
+            particle_t p = fill ? PAINT : EMPTY;
+            int y = SEEDS[s][0], x = SEEDS[s][1];
+            int changed = floodFill(&w, y, x, p);
+            int expected = floodReference(&reference, y, x, p);
+            char what[32];
+            snprintf(what, sizeof(what), "%s flood %d", fill ? "fill" : "erase", s);
+            compare(&w, &reference, changed, expected, what);
+            worldFree(&w);
+            worldFree(&reference);
+        }
+    }
+
+    // recoloring a pile keeps it and reaches every grain of it
+    world_t w;
+    worldInit(&w, 64, 64, 1);
+    setRect(&w, 40, 10, 64, 50, grain(0, 0));
+    setRect(&w, 30, 20, 40, 22, grain(0, 0));
+    CHECK(floodFill(&w, 63, 11, PAINT) == 0, "recoloring changed occupancy");
+    CHECK(at(&w, 30, 21).c == PAINT.c && at(&w, 63, 49).c == PAINT.c, "recoloring missed part of the pile");
+    CHECK(floodFill(&w, 10, 10, EMPTY) == 0 && floodFill(&w, -1, 0, PAINT) == 0, "flood outside a region changed cells");
+    worldFree(&w);
+}
+
+int main() {
+    checkRect();
+    checkCircle();
+    checkPolygon();
+    checkFlood();
+    return checkResult();
+}
@@ -0,0 +1,200 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "check.h"
+#include "flow.h"
+#include "sim.h"
+
+// emitters add grains at their rate with fractions carried over, sinks take them out,
+// a scene file builds the same world and flow as the calls, and bad files are refused
+
+static const char* PATH = "sandsim_test.scene";
+
+static void writeFile(const char* text) {
+    FILE* file = fopen(PATH, "w");
+    fputs(text, file);
+    fclose(file);
+}
+
+// a rate of 2.5 adds 5 grains every 2 updates, until the shape is full
+static void checkRate() {
+    world_t w;
+    worldInit(&w, 32, 32, 1);
+    flow_t f;
+    flowInit(&f);
+    flowAddEmitter(&f, (shape_t) { SHAPE_RECT, 0, 0, 4, 8, 0 }, 2.5f);
+    for (int k = 1; k <= 12; k++) {
+        flowApply(&f, &w);
+        CHECK(countGrains(&w) == 5 * k / 2, "%d grains after %d updates, expected %d", countGrains(&w), k, 5 * k / 2);
+    }
+    // the shape holds 32 grains, and nothing falls out of it without an update
+    for (int k = 0; k < 10; k++) flowApply(&f, &w);
+    CHECK(countGrains(&w) == 32 && f.emitted == 32, "%d grains, %lld emitted, expected a full shape", countGrains(&w), f.emitted);
+    CHECK(countRect(&w, 0, 0, 4, 8) == 32, "grains outside the emitter's shape");
+    flowFree(&f);
+    worldFree(&w);
+}
+
+// a disc clipped by the world's edge only fills cells inside it
+static void checkClip() {
+    world_t w;
+    worldInit(&w, 16, 16, 1);
+    flow_t f;
+    flowInit(&f);
+    flowAddEmitter(&f, (shape_t) { SHAPE_DISC, 0, 0, 0, 0, 6 }, 1000);
+    flowApply(&f, &w);
+    int cells = 0;
+    for (int y = 0; y < 16; y++) {
+        int x0, x1;
+        if (shapeSpan(&f.emitters[0].shape, y, &x0, &x1)) cells += x1 - (x0 < 0 ? 0 : x0);
+    }
+    CHECK(countGrains(&w) == cells && cells > 0, "%d grains in a clipped disc of %d cells", countGrains(&w), cells);
+    flowFree(&f);
+    worldFree(&w);
+}
+
+// an emitter writing runs of empty cells as spans leaves the same grains, colors and
+// bookkeeping as set() on each cell in turn
+static void checkSpans() {
+    world_t w, reference;
+    worldInit(&w, 40, 40, 3);
+    worldInit(&reference, 40, 40, 3);
+    particle_t wall = { RGB(9, 9, 9), true, false, 0 };
+    for (int y = 0; y < 5; y++) {
+        for (int x = (y & 1); x < 30; x += 2 + (x % 5 == 0)) {
+            set(&w, y, x, wall);
+            set(&reference, y, x, wall);
+        }
+    }
+    flow_t f;
+    flowInit(&f);
+    flowAddEmitter(&f, (shape_t) { SHAPE_RECT, 0, 0, 5, 30, 0 }, 37);
+    for (int k = 0; k < 2; k++) {
+        flowApply(&f, &w);
+        int filled = 0;
+        for (int y = 0; y < 5; y++) {
+            for (int x = 0; x < 30 && filled < 37; x++) {
+                if (at(&reference, y, x).e) continue;
+                interpolateColor(&reference);
+                set(&reference, y, x, (particle_t) { reference.currentColor, true, false, 0 });
+                filled++;
+            }
+        }
+        CHECK(hashWorld(&w) == hashWorld(&reference), "emitted grains differ from set() after %d updates", k + 1);
+        CHECK(consistent(&w), "bookkeeping out of sync after %d updates", k + 1);
+    }
+    flowFree(&f);
+    worldFree(&w);
+    worldFree(&reference);
+}
+
+// with a sink under an emitter the world settles into grains in = grains out
+static void checkSteady() {
+    world_t w;
+    worldInit(&w, 64, 64, 7);
+    flow_t f;
+    flowInit(&f);
+    flowAddEmitter(&f, (shape_t) { SHAPE_DISC, 4, 32, 0, 0, 3 }, 3);
+    flowAddSink(&f, (shape_t) { SHAPE_RECT, 62, 0, 2, 64, 0 }, 0);
+    int last = 0;
+    for (int k = 0; k < 600; k++) {
+        flowStep(&f, &w);
+        CHECK(countGrains(&w) == f.emitted - f.removed, "%d grains after update %d, %lld in and %lld out",
+              countGrains(&w), k, f.emitted, f.removed);
+        if (k == 499) last = countGrains(&w);
+    }
+    CHECK(f.removed > 0, "sink never took a grain");
+    CHECK(abs(countGrains(&w) - last) <= 6, "not steady, %d grains then %d", last, countGrains(&w));
+    CHECK(countRect(&w, 62, 0, 64, 64) <= 6, "%d grains left in the sink", countRect(&w, 62, 0, 64, 64));
+
+    // a sink with a rate takes no more than it per update
+    flowClear(&f);
+    flowAddSink(&f, (shape_t) { SHAPE_RECT, 0, 0, 64, 64, 0 }, 5);
+    int before = countGrains(&w);
+    flowApply(&f, &w);
+    CHECK(countGrains(&w) == before - 5 || before < 5, "rate 5 sink took %d grains", before - countGrains(&w));
+    flowFree(&f);
+    worldFree(&w);
+}
+
+// the file gives the same world as the calls
+static void checkLoad() {
+    writeFile("# a pour into a drain\n"
+              "world 48 40 9\n"
+              "\n"
+              "emitter disc 3 24 2 1.5   # top middle\n"
+              "sink rect 38 0 2 48\n"
+              "sink disc 20 5 3 2\n");
+    world_t w, again;
+    flow_t f, other;
+    CHECK(flowLoad(&w, &f, PATH), "can't load a good file");
+    CHECK(w.width == 48 && w.height == 40, "world is %dx%d", w.width, w.height);
+    CHECK(f.emitterCount == 1 && f.sinkCount == 2, "%d emitters and %d sinks", f.emitterCount, f.sinkCount);
+    CHECK(f.sinks[0].rate == 0 && f.sinks[1].rate == 2, "sink rates %d and %d", f.sinks[0].rate, f.sinks[1].rate);
+
+    worldInit(&again, 48, 40, 9);
+    flowInit(&other);
+    flowAddEmitter(&other, (shape_t) { SHAPE_DISC, 3, 24, 0, 0, 2 }, 1.5f);
+    flowAddSink(&other, (shape_t) { SHAPE_RECT, 38, 0, 2, 48, 0 }, 0);
+    flowAddSink(&other, (shape_t) { SHAPE_DISC, 20, 5, 0, 0, 3 }, 2);
+    for (int k = 0; k < 200; k++) {
+        flowStep(&f, &w);
+        flowStep(&other, &again);
+    }
+    CHECK(hashWorld(&w) == hashWorld(&again), "loaded world ran differently");
+    flowFree(&f);
+    flowFree(&other);
+    worldFree(&w);
+    worldFree(&again);
+
+    writeFile("world 32 32\nscene pour\nsink rect 30 0 2 32 4\n");
+    if (flowLoad(&w, &f, PATH)) {
+        CHECK(countGrains(&w) == 0 && f.sinkCount == 1, "pour scene isn't empty or sink missing");
+        flowFree(&f);
+        worldFree(&w);
+    } else {
+        CHECK(false, "can't load a file with a scene");
+    }
+
+    static const char* BAD[] = {
+        "emitter rect 0 0 4 4 1\n",
+        "world 32 32\nworld 32 32\n",
+        "world 0 32\n",
+        "world 32 32\nemitter rect 0 0 4 4\n",
+        "world 32 32\nemitter disc 4 4 0 1\n",
+        "world 32 32\nsink star 1 2 3\n",
+        "world 32 32\nscene nothing\n",
+        "world 32 32\nfountain rect 0 0 4 4 1\n",
+        "# nothing\n",
+        "world 32 32\nemitter rect 10 foo 4 4 x\n",
+        "world 32 32\nemitter rect 0 0 4 4 1.5x\n",
+        "world 32x 32\n",
+        "world 32 32 seed\n",
+        "world 32 32\nsink disc 4 4 3 -2\n",
+        "world 32 32\nsink disc 4 4 3 2 2\n",
+    };
+    for (int i = 0; i < (int) (sizeof(BAD) / sizeof(BAD[0])); i++) {
+        writeFile(BAD[i]);
+        CHECK(!flowLoad(&w, &f, PATH), "loaded bad file %d", i);
+    }
+    // a line too long to read whole is refused rather than split in two, here a comment
+    // that would end in a sink
+    char longLine[400] = "world 32 32\n#";
+    size_t length = strlen(longLine);
+    memset(longLine + length, ' ', 300);
+    strcpy(longLine + length + 300, "sink rect 0 0 1 1\n");
+    writeFile(longLine);
+    CHECK(!flowLoad(&w, &f, PATH), "loaded a file with a line over 255 characters");
+    CHECK(!flowLoad(&w, &f, "sandsim_no_such.scene"), "loaded a missing file");
+    remove(PATH);
+}
+
+int main() {
+    checkRate();
+    checkClip();
+    checkSpans();
+    checkSteady();
+    checkLoad();
+    return checkResult();
+}
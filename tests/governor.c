@@ -0,0 +1,98 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "check.h"
+#include "governor.h"
+
+// drives the governor with made up costs and checks what it decides
+
+static const double FRAME = 1.0 / 60;
+
+// run frames at 60 Hz with every update costing step and every render costing render
+// at full quality and a quarter of it reduced. returns the updates run
+static long run(governor_t* g, int frames, double step, double render) {
+    long total = 0;
+    for (int f = 0; f < frames; f++) {
+        int n = governorPlan(g, FRAME);
+        governorStepped(g, n, n * step);
+        bool reduced = governorReduced(g);
+        governorRendered(g, reduced, reduced ? render / 4 : render);
+        total += n;
+    }
+    return total;
+}
+
+// cheap updates all run, at the asked for rate
+static void checkKeepsUp() {
+    governor_t g;
+    governorInit(&g, FRAME, 220, 16);
+    long total = run(&g, 600, 0.0001, 0.002);
+    CHECK(total >= 2195 && total <= 2200, "%ld updates in 10 s at 220/s", total);
+    CHECK(!g.reduced, "reduced quality with room to spare");
+}
+
+// expensive updates are cut down to what fits next to the render
+static void checkLimits() {
+    governor_t g;
+    governorInit(&g, FRAME, 220, 16);
+    run(&g, 60, 0.004, 0.004);
+    CHECK(g.substeps == 3, "%d updates of 4 ms next to a 4 ms render in a 16.7 ms frame", g.substeps);
+    CHECK(!g.reduced, "reduced quality though it wouldn't fit more updates");
+    // none of what was dropped is owed later
+    CHECK(g.owed < 1, "%.1f updates still owed", g.owed);
+}
+
+// a render that leaves no room for an update is reduced, and comes back once updates get cheap
+static void checkReduces() {
+    governor_t g;
+    governorInit(&g, FRAME, 220, 16);
+    run(&g, 60, 0.002, 0.016);
+    CHECK(g.reduced, "full quality with a render filling the frame");
+    CHECK(g.substeps >= 3, "%d updates at reduced quality", g.substeps);
+    run(&g, 10, 0.0001, 0.001);
+    CHECK(g.reduced, "left reduced quality without waiting");
+    run(&g, 60, 0.0001, 0.001);
+    CHECK(!g.reduced, "stuck at reduced quality");
+}
+
+// a render spike that caused reduced quality doesn't keep it there once renders are cheap
+// again, though only reduced frames were being timed
+static void checkProbes() {
+    governor_t g;
+    governorInit(&g, FRAME, 220, 16);
+    run(&g, 60, 0.002, 0.016);
+    CHECK(g.reduced, "full quality with a render filling the frame");
+    run(&g, 200, 0.002, 0.002);
+    CHECK(!g.reduced, "stuck at reduced quality after the render got cheap, render cost %.3f ms",
+          g.renderCost * 1e3);
+    // while the render stays expensive the probes don't bring full quality back
+    governorInit(&g, FRAME, 220, 16);
+    run(&g, 300, 0.002, 0.016);
+    CHECK(g.reduced, "left reduced quality with a render still filling the frame");
+}
+
+static void checkLog() {
+    governor_t g;
+    governorInit(&g, FRAME, 220, 16);
+    g.log = tmpfile();
+    run(&g, 60, 0.0001, 0.002);
+    run(&g, 60, 0.004, 0.004);
+    run(&g, 60, 0.0001, 0.002);
+    long size = ftell(g.log);
+    CHECK(size > 0, "no decisions logged");
+    rewind(g.log);
+    char line[256];
+    int lines = 0;
+    while (fgets(line, sizeof(line), g.log)) lines++;
+    CHECK(lines >= 2 && lines <= 4, "%d lines logged for 2 changes", lines);
+    fclose(g.log);
+}
+
+int main() {
+    checkKeepsUp();
+    checkLimits();
+    checkReduces();
+    checkProbes();
+    checkLog();
+    return checkResult();
+}
@@ -0,0 +1,110 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "check.h"
+#include "heat.h"
+#include "sim.h"
+
+// the heat field diffuses without leaking through its edges, and melts, runs and sets
+// the grains of the blocks it heats
+
+// with no cooling heat only moves around, and spreads evenly from a point
+static void checkDiffusion() {
+    world_t w;
+    worldInit(&w, 130, 70, 1);
+    heat_t h;
+    heatInit(&h, &w, 2);
+    h.cooling = 0;
+    heatAdd(&h, 64, 64, 100);
+    for (int s = 0; s < 500; s++) {
+        heatDiffuse(&h);
+    }
+    double total = heatTotal(&h);
+    CHECK(fabs(total - 100) < 1e-2, "total heat %f after diffusing, expected 100", total);
+    float left = heatAt(&h, 64, 64 - 20), right = heatAt(&h, 64, 64 + 20);
+    CHECK(left > 0 && fabsf(left - right) < 1e-4f * left, "heat spread unevenly, %g left and %g right", left,
+          right);
+
+    h.cooling = 0.01f;
+    heatDiffuse(&h);
+    CHECK(heatTotal(&h) < total, "cooling didn't lose any heat");
+    heatFree(&h);
+    worldFree(&w);
+}
+
+static COLORREF colorOf(RGBTRIPLE c) {
+    return RGB(c.rgbtRed, c.rgbtGreen, c.rgbtBlue);
+}
+
+// a heated block of grains melts, sets to glass once cooled, and the rest stays as it was
+static void checkGlass() {
+    world_t w;
+    worldInit(&w, 64, 64, 1);
+    COLORREF sand = RGB(1, 2, 3);
+    for (int i = 32; i < 64; i++) {
+        for (int j = 0; j < 64; j++) set(&w, i, j, (particle_t) { sand, true, false, 0 });
+    }
+    heat_t h;
+    heatInit(&h, &w, 2);
+    heatAdd(&h, 40, 40, 20);
+    heatUpdate(&h, &w);
+    CHECK(at(&w, 40, 40).c == colorOf(MOLTEN_COLOR), "heated grain didn't melt");
+    CHECK(at(&w, 60, 5).c == sand, "cold grain changed color");
+
+    for (int s = 1; s < 20000 && heatAt(&h, 40, 40) >= GLASS_POINT; s++) {
+        w.step = s;
+        heatUpdate(&h, &w);
+    }
+    w.step++;
+    while (w.step % h.every) w.step++;
+    heatUpdate(&h, &w);
+    CHECK(heatAt(&h, 40, 40) < GLASS_POINT, "block never cooled");
+    CHECK(at(&w, 40, 40).c == colorOf(GLASS_COLOR), "molten grain didn't set to glass");
+    CHECK(at(&w, 60, 5).c == sand, "far grain melted");
+    heatFree(&h);
+    worldFree(&w);
+}
+
+// widest filled run of a row
+static int rowWidth(const world_t* w, int y) {
+    int widest = 0, run = 0;
+    for (int j = 0; j < w->width; j++) {
+        run = at(w, y, j).e ? run + 1 : 0;
+        if (run > widest) widest = run;
+    }
+    return widest;
+}
+
+// a settled heap spreads out along the floor once it melts, and no grain is lost
+static void checkFlow() {
+    world_t w;
+    worldInit(&w, 128, 64, 1);
+    for (int i = 40; i < 64; i++) {
+        for (int j = 56; j < 72; j++) set(&w, i, j, (particle_t) { RGB(1, 2, 3), true, false, 0 });
+    }
+    for (int s = 0; s < 200; s++) UpdateGrid(&w);
+    int grains = countGrains(&w), settled = rowWidth(&w, 63);
+
+    heat_t h;
+    heatInit(&h, &w, 2);
+    h.cooling = 0;
+    for (int s = 0; s < 400; s++) {
+        for (int j = 0; j < w.width; j += 4) heatAdd(&h, 60, j, 0.5f);
+        UpdateGrid(&w);
+        heatUpdate(&h, &w);
+    }
+    int spread = rowWidth(&w, 63);
+    CHECK(spread > settled + 8, "melted heap is %d wide at the floor, %d before", spread, settled);
+    CHECK(countGrains(&w) == grains, "%d grains after melting, %d before", countGrains(&w), grains);
+    CHECK(consistent(&w), "bookkeeping off after molten grains ran");
+    heatFree(&h);
+    worldFree(&w);
+}
+
+int main() {
+    checkDiffusion();
+    checkGlass();
+    checkFlow();
+    return checkResult();
+}
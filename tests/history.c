@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "check.h"
+#include "history.h"
+#include "scene.h"
+#include "sim.h"
+
+// stepping back and forth through a history gives back every update exactly, a world
+// stepped back to carries on the same as it did the first time, and the memory limit
+// holds by dropping the oldest frames
+
+enum { STEPS = 300 };
+
+// hashWorld() leaves out fall speeds, which decide how the world carries on
+static uint64_t hashFull(const world_t* w) {
+    uint64_t h = hashWorld(w);
+    for (int i = 0; i < w->height; i++) {
+        for (int j = 0; j < w->width; j++) {
+            if (at(w, i, j).e) h = h * 31 + at(w, i, j).v * 7 + at(w, i, j).a;
+        }
+    }
+    return h;
+}
+
+static void checkScene(const char* name, bool worklist) {
+    const scene_type_t* scene = findScene(name);
+    world_t w;
+    sceneCreate(&w, scene, 96, 80, 5);
+    w.worklist = worklist;
+    history_t h;
+    historyInit(&h, &w, (size_t) 1 << 30, 16);
+    uint64_t* hashes = malloc((STEPS + 1) * sizeof(uint64_t));
+    hashes[0] = hashFull(&w);
+    for (int k = 1; k <= STEPS; k++) {
+        sceneStep(&w, scene);
+        historyRecord(&h, &w);
+        hashes[k] = hashFull(&w);
+    }
+    CHECK(historyOldest(&h) == 0 && historyNewest(&h) == STEPS, "%s: history covers %u to %u",
+          name, historyOldest(&h), historyNewest(&h));
+
+    // back a step at a time, forward in strides, then jumps either way
+    for (int k = STEPS - 1; k >= 0; k -= 7) {
+        CHECK(historySeek(&h, &w, k) == (uint32_t) k && w.step == (uint32_t) k, "%s: seek to %d landed on %u", name, k, w.step);
+        CHECK(hashFull(&w) == hashes[k], "%s: world at %d differs stepping back", name, k);
+    }
+    for (int k = 0; k <= STEPS; k += 5) {
+        historySeek(&h, &w, k);
+        CHECK(hashFull(&w) == hashes[k], "%s: world at %d differs replaying", name, k);
+    }
+    static const int JUMPS[] = { 3, 250, 17, 17, 299, 0, 150 };
+    for (int i = 0; i < 7; i++) {
+        historySeek(&h, &w, JUMPS[i]);
+        CHECK(hashFull(&w) == hashes[JUMPS[i]], "%s: world at %d differs after a jump", name, JUMPS[i]);
+        CHECK(consistent(&w), "%s: bookkeeping out of sync at %d", name, JUMPS[i]);
+    }
+
+    // a grain painted in between is undone by the next seek
+    set(&w, 0, 0, (particle_t) { RGB(1, 2, 3), true, false, 0 });
+    historySeek(&h, &w, 151);
+    CHECK(hashFull(&w) == hashes[151], "%s: painted world differs after a seek", name);
+
+    // carrying on from 100 steps back ends up where it did, and drops the old future
+    historySeek(&h, &w, STEPS - 100);
+    for (int k = STEPS - 99; k <= STEPS; k++) {
+        sceneStep(&w, scene);
+        historyRecord(&h, &w);
+        if (k == STEPS - 99) CHECK(historyNewest(&h) == (uint32_t) k, "%s: newest frame %u after carrying on", name, historyNewest(&h));
+    }
+    CHECK(hashFull(&w) == hashes[STEPS], "%s: world carried on differently", name);
+    historySeek(&h, &w, STEPS - 50);
+    CHECK(hashFull(&w) == hashes[STEPS - 50], "%s: rerecorded world at %d differs", name, STEPS - 50);
+
+    free(hashes);
+    historyFree(&h);
+    worldFree(&w);
+}
+
+// a small limit keeps only the newest frames and never holds much over it
+static void checkLimit() {
+    const scene_type_t* scene = findScene("pour");
+    world_t w;
+    sceneCreate(&w, scene, 64, 64, 2);
+    for (int k = 0; k < 100; k++) sceneStep(&w, scene);
+    history_t h;
+    historyInit(&h, &w, 0, 8);
+    size_t first = h.bytes;
+    historyFree(&h);
+
+    size_t limit = first * 20;
+    historyInit(&h, &w, limit, 8);
+    size_t most = 0;
+    for (int k = 1; k <= STEPS; k++) {
+        sceneStep(&w, scene);
+        historyRecord(&h, &w);
+        if (h.bytes > most) most = h.bytes;
+    }
+    CHECK(historyOldest(&h) > 100 && historyNewest(&h) == STEPS + 100, "history covers %u to %u", historyOldest(&h), historyNewest(&h));
+    CHECK(most <= limit + 2 * first, "frames took %zu bytes against a limit of %zu", most, limit);
+    CHECK(historyMemory(&h) > h.bytes, "memory %zu doesn't count the world copy", historyMemory(&h));
+    CHECK(historySeek(&h, &w, 0) == historyOldest(&h), "seek before the oldest frame went to %u", w.step);
+    CHECK(consistent(&w), "bookkeeping out of sync at the oldest frame");
+    historyFree(&h);
+
+    // a limit too small for even one keyframe still keeps the newest
+    historyInit(&h, &w, 1, 8);
+    for (int k = 0; k < 20; k++) {
+        sceneStep(&w, scene);
+        historyRecord(&h, &w);
+    }
+    CHECK(h.count >= 1 && historyNewest(&h) == w.step, "newest frame %u, world at %u", historyNewest(&h), w.step);
+    historyFree(&h);
+    worldFree(&w);
+}
+
+int main() {
+    checkScene("pour", false);
+    checkScene("noise", false);
+    checkScene("noise", true);
+    checkScene("avalanche", true);
+    checkLimit();
+    return checkResult();
+}
@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "check.h"
+#include "margolus.h"
+#include "sim.h"
+
+// the block rule keeps every grain, only moves grains down, keeps the bookkeeping in
+// step, and piles sand up instead of leaving towers standing
+
+static particle_t grain(int y, int x) {
+    return (particle_t) { RGB(x, y, 1), true, false, 0 };
+}
+
+// sum of the rows of every grain, which falling can only raise
+static long long depth(const world_t* w) {
+    long long sum = 0;
+    for (int i = 0; i < w->height; i++) {
+        for (int j = 0; j < w->width; j++) {
+            if (at(w, i, j).e) sum += i;
+        }
+    }
+    return sum;
+}
+
+static void checkNoise() {
+    static const int SIZES[][2] = { { 1, 1 }, { 2, 2 }, { 3, 9 }, { 64, 64 }, { 101, 77 } };
+    for (int s = 0; s < 5; s++) {
+        world_t w;
+        worldInit(&w, SIZES[s][0], SIZES[s][1], 3);
+        unsigned state = 99;
+        for (int i = 0; i < w.height; i++) {
+            for (int j = 0; j < w.width; j++) {
+                state = state * 1664525u + 1013904223u;
+                if ((state >> 8) % 100 < 45) set(&w, i, j, grain(i, j));
+            }
+        }
+        int grains = countGrains(&w);
+        long long before = depth(&w);
+        int quiet = 0;
+        for (int k = 0; k < 4 * w.height + 50 && quiet < 4; k++) {
+            int moved = UpdateGridMargolus(&w);
+            long long after = depth(&w);
+            CHECK(after - before == moved, "%dx%d: grains moved %lld rows down on update %d, %d moved",
+                  w.width, w.height, after - before, k, moved);
+            CHECK(consistent(&w), "%dx%d: bookkeeping out of sync after update %d", w.width, w.height, k);
+            before = after;
+            quiet = moved ? 0 : quiet + 1;
+        }
+        CHECK(countGrains(&w) == grains, "%dx%d: %d grains, expected %d", w.width, w.height, countGrains(&w), grains);
+        CHECK(quiet >= 4, "%dx%d: never settled", w.width, w.height);
+        worldFree(&w);
+    }
+}
+
+// a grain falls a cell per update until it lands
+static void checkFall() {
+    world_t w;
+    worldInit(&w, 8, 40, 1);
+    set(&w, 0, 4, grain(0, 4));
+    for (int k = 1; k <= 39; k++) {
+        UpdateGridMargolus(&w);
+        CHECK(at(&w, k, 4).e, "grain not at row %d after %d updates", k, k);
+    }
+    worldFree(&w);
+}
+
+// a one wide tower has to spread out into a pile
+static void checkPile() {
+    world_t w, again;
+    worldInit(&w, 64, 64, 11);
+    worldInit(&again, 64, 64, 11);
+    for (int i = 0; i < 48; i++) {
+        set(&w, i, 32, grain(i, 32));
+        set(&again, i, 32, grain(i, 32));
+    }
+    for (int k = 0; k < 2000; k++) {
+        UpdateGridMargolus(&w);
+        UpdateGridMargolus(&again);
+    }
+    CHECK(hashWorld(&w) == hashWorld(&again), "same seed settled differently");
+    CHECK(columnGrains(&w, 32) < 16, "tower still %d grains tall", columnGrains(&w, 32));
+    int left = countRect(&w, 0, 0, 64, 32), right = countRect(&w, 0, 33, 64, 64);
+    CHECK(left > 8 && right > 8, "pile lopsided, %d grains left of the tower and %d right", left, right);
+    worldFree(&w);
+    worldFree(&again);
+}
+
+int main() {
+    checkNoise();
+    checkFall();
+    checkPile();
+    return checkResult();
+}
@@ -0,0 +1,162 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "check.h"
+#include "mip.h"
+#include "sim.h"
+
+// a pyramid kept up to date from the written chunks has to match one built from
+// scratch, and rendering has to show what is in the world
+
+static unsigned random32(unsigned* state) {
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+// level the two pyramids first differ at, 0 if they match
+static int firstDifference(const mip_t* a, const mip_t* b) {
+    for (int k = 1; k <= a->levels; k++) {
+        const mip_level_t* la = &a->level[k];
+        const mip_level_t* lb = &b->level[k];
+        for (int t = 0; t < la->width * la->height; t++) {
+            if (la->texels[t].count != lb->texels[t].count || la->texels[t].color != lb->texels[t].color) return k;
+        }
+    }
+    return 0;
+}
+
+static void checkIncremental(int width, int height) {
+    world_t w;
+    worldInit(&w, width, height, 3);
+    mip_t kept;
+    mipInit(&kept, &w);
+    unsigned state = 11;
+    for (int s = 0; s < 120; s++) {
+        // scattered edits, a pour and the update itself all leave chunks to reduce
+        for (int k = 0; k < 40; k++) {
+            int i = random32(&state) % height;
+            int j = random32(&state) % width;
+            set(&w, i, j, random32(&state) % 4 ? (particle_t) { RGB(i, j, s), true, false, 0 } : EMPTY);
+        }
+        if (s < 60) pour(&w, 5);
+        UpdateGrid(&w);
+        mipUpdate(&kept, &w);
+
+        if (s % 20 == 19) {
+            mip_t fresh;
+            mipInit(&fresh, &w);
+            mipUpdate(&fresh, &w);
+            int level = firstDifference(&kept, &fresh);
+            CHECK(level == 0, "%dx%d: level %d out of date after update %d", width, height, level, s);
+            mipFree(&fresh);
+        }
+    }
+    const mip_level_t* top = &kept.level[kept.levels];
+    CHECK(kept.levels == 0 || (top->width == 1 && top->height == 1), "%dx%d: top level is %dx%d", width, height,
+          top->width, top->height);
+    CHECK(kept.levels == 0 || (int) top->texels[0].count == countGrains(&w),
+          "%dx%d: top level counts %u grains, world has %d", width, height, top->texels[0].count, countGrains(&w));
+    mipFree(&kept);
+    worldFree(&w);
+}
+
+static void checkRender() {
+    world_t w;
+    worldInit(&w, 64, 48, 1);
+    // left half solid red, right half a checkerboard of blue
+    for (int i = 0; i < 48; i++) {
+        for (int j = 0; j < 64; j++) {
+            if (j < 32) set(&w, i, j, (particle_t) { RGB(255, 0, 0), true, false, 0 });
+            else if ((i + j) & 1) set(&w, i, j, (particle_t) { RGB(0, 0, 200), true, false, 0 });
+        }
+    }
+    mip_t m;
+    mipInit(&m, &w);
+    mipUpdate(&m, &w);
+
+    // a pixel per cell shows the cells themselves
+    uint32_t* pixels = malloc(64 * 48 * sizeof(uint32_t));
+    mipRender(&m, &w, (camera_t) { 0, 0, 1 }, pixels, 64, 48, RGB(0, 0, 0));
+    CHECK(pixels[0] == 0xFF0000, "cell (0, 0) drawn as %06x", pixels[0]);
+    CHECK(pixels[33] == 0x0000C8 && pixels[32] == 0, "checkerboard drawn as %06x %06x", pixels[32], pixels[33]);
+
+    // four cells per pixel: solid stays solid, the checkerboard is half as bright
+    mipRender(&m, &w, (camera_t) { 0, 0, 4 }, pixels, 16, 12, RGB(0, 0, 0));
+    CHECK(pixels[0] == 0xFF0000, "solid block drawn as %06x", pixels[0]);
+    CHECK(pixels[12] == 0x000064, "checkerboard block drawn as %06x", pixels[12]);
+
+    // off the world is background
+    mipRender(&m, &w, (camera_t) { -10, 0, 1 }, pixels, 8, 1, RGB(1, 2, 3));
+    CHECK(pixels[0] == 0x010203, "off the world drawn as %06x", pixels[0]);
+
+    free(pixels);
+    mipFree(&m);
+    worldFree(&w);
+}
+
+// a pyramid only updated for what is on screen draws the same screen as one kept whole,
+// and never reduces chunks that are off it
+static void checkView() {
+    world_t w;
+    worldInit(&w, 512, 384, 9);
+    mip_t whole, viewed;
+    mipInit(&whole, &w);
+    mipInit(&viewed, &w);
+    enum { SCREEN_W = 160, SCREEN_H = 120 };
+    uint32_t* expected = malloc(SCREEN_W * SCREEN_H * sizeof(uint32_t));
+    uint32_t* actual = malloc(SCREEN_W * SCREEN_H * sizeof(uint32_t));
+
+    // zoomed in on the top left, then zooming out around a point, then panned off the world
+    camera_t camera = { 10, 20, 0.5 };
+    unsigned state = 5;
+    for (int s = 0; s < 200; s++) {
+        for (int k = 0; k < 30; k++) {
+            int j = random32(&state) % w.width;
+            set(&w, random32(&state) % 64, j, (particle_t) { RGB(j, s, 7), true, false, 0 });
+        }
+        UpdateGrid(&w);
+        if (s % 10 == 0) cameraZoom(&camera, 0.8, 40, 30);
+        if (s > 150) cameraPan(&camera, 3, 2);
+
+        mipUpdate(&whole, &w);
+        mipUpdateView(&viewed, &w, camera, SCREEN_W, SCREEN_H);
+        // the bottom right chunk is still off screen
+        if (s == 60) CHECK(viewed.reduced[w.chunksX * w.chunksY - 1] == 0, "chunk off screen was reduced");
+        mipRender(&whole, &w, camera, expected, SCREEN_W, SCREEN_H, RGB(0, 0, 0));
+        mipRender(&viewed, &w, camera, actual, SCREEN_W, SCREEN_H, RGB(0, 0, 0));
+        if (memcmp(expected, actual, SCREEN_W * SCREEN_H * sizeof(uint32_t)) != 0) {
+            CHECK(false, "view at scale %.3f differs after update %d", camera.scale, s);
+            break;
+        }
+    }
+
+    // zooming about a point keeps the world under it in place
+    camera_t c = { 100, 50, 2 };
+    double x0, y0, x1, y1;
+    cameraToWorld(&c, 33, 44, &x0, &y0);
+    cameraZoom(&c, 3, 33, 44);
+    cameraToWorld(&c, 33, 44, &x1, &y1);
+    CHECK(fabs(x1 - x0) < 1e-9 && fabs(y1 - y0) < 1e-9, "zoom moved (%g, %g) to (%g, %g)", x0, y0, x1, y1);
+    double sx, sy;
+    cameraToScreen(&c, x1, y1, &sx, &sy);
+    CHECK(fabs(sx - 33) < 1e-9 && fabs(sy - 44) < 1e-9, "screen (33, 44) maps back to (%g, %g)", sx, sy);
+
+    free(expected);
+    free(actual);
+    mipFree(&whole);
+    mipFree(&viewed);
+    worldFree(&w);
+}
+
+int main() {
+    checkIncremental(128, 128);
+    checkIncremental(100, 37);
+    checkIncremental(1, 70);
+    checkIncremental(1, 1);
+    checkIncremental(300, 300);
+    checkRender();
+    checkView();
+    return checkResult();
+}
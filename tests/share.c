@@ -0,0 +1,133 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "check.h"
+#include "share.h"
+#include "sim.h"
+#include "thread.h"
+
+// a shared world keeps updating exactly as a private one does, a reader sees the
+// live cells, and no snapshot it takes is ever caught halfway through an update
+
+static const char* NAME = "sandsim_share_test";
+
+static void fill(world_t* w) {
+    unsigned state = 12345;
+    for (int i = 0; i < w->height; i++) {
+        for (int j = 0; j < w->width; j++) {
+            state = state * 1664525u + 1013904223u;
+            if ((state >> 8) % 100 < 40) set(w, i, j, (particle_t) { RGB(i, j, 7), true, false, 0 });
+        }
+    }
+}
+
+static int countCells(const particle_t* cells, int width, int height) {
+    int count = 0;
+    for (int i = 0; i < height; i++) {
+        for (int j = 0; j < width; j++) count += cells[(i + 1) * (width + 2) + j + 1].e;
+    }
+    return count;
+}
+
+static void checkRoundTrip() {
+    world_t shared, private;
+    worldInit(&shared, 70, 90, 5);
+    worldInit(&private, 70, 90, 5);
+    fill(&shared);
+    fill(&private);
+
+    share_t s, r;
+    CHECK(shareOpen(&s, &shared, NAME), "can't open shared segment");
+    CHECK(shareAttach(&r, NAME), "can't attach to shared segment");
+    CHECK(r.header->width == 70 && r.header->height == 90, "header says %ux%u", r.header->width, r.header->height);
+
+    for (int k = 0; k < 50; k++) {
+        shareBegin(&s);
+        UpdateGrid(&shared);
+        shareEnd(&s);
+        UpdateGrid(&private);
+    }
+    CHECK(hashWorld(&shared) == hashWorld(&private), "shared world updated differently");
+
+    size_t bytes = (size_t) shared.stride * (shared.height + 2) * sizeof(particle_t);
+    particle_t* cells = malloc(bytes);
+    uint32_t step = 0;
+    CHECK(shareSnapshot(&r, cells, &step, 1), "snapshot failed with nothing writing");
+    CHECK(step == 50, "snapshot of update %u, expected 50", step);
+    CHECK(memcmp(cells, private.cells, bytes) == 0, "snapshot differs from the world");
+
+    int sequence = shareReadBegin(&r);
+    CHECK(shareReadValid(&r, sequence), "read invalid with nothing writing");
+    shareBegin(&s);
+    set(&shared, 0, 0, (particle_t) { RGB(1, 2, 3), true, false, 0 });
+    shareEnd(&s);
+    CHECK(!shareReadValid(&r, sequence), "read still valid across a write");
+    CHECK(shareCells(&r)[cellIndex(&shared, 0, 0)].e, "reader doesn't see the live cells");
+
+    shareClose(&s);
+    shareDetach(&r);
+    CHECK(!shareAttach(&r, NAME), "segment still there after closing");
+    set(&private, 0, 0, (particle_t) { RGB(1, 2, 3), true, false, 0 });
+    UpdateGrid(&shared);
+    UpdateGrid(&private);
+    CHECK(hashWorld(&shared) == hashWorld(&private), "world changed by closing its segment");
+
+    free(cells);
+    worldFree(&shared);
+    worldFree(&private);
+}
+
+typedef struct reader {
+    int grains;
+    int done;
+    int snapshots;
+    int torn;
+} reader_t;
+
+static void* readLoop(void* arg) {
+    reader_t* rd = arg;
+    share_t r;
+    if (!shareAttach(&r, NAME)) return NULL;
+    int width = (int) r.header->width, height = (int) r.header->height;
+    particle_t* cells = malloc((size_t) (width + 2) * (height + 2) * sizeof(particle_t));
+    while (!atomicLoad(&rd->done)) {
+        if (!shareSnapshot(&r, cells, NULL, 1000)) continue;
+        atomicAdd(&rd->snapshots, 1);
+        if (countCells(cells, width, height) != rd->grains) rd->torn++;
+        threadYield();
+    }
+    free(cells);
+    shareDetach(&r);
+    return NULL;
+}
+
+// grains are only ever moved, so a snapshot with any other count was torn
+static void checkConcurrentReader() {
+    world_t w;
+    worldInit(&w, 256, 256, 9);
+    fill(&w);
+    share_t s;
+    CHECK(shareOpen(&s, &w, NAME), "can't open shared segment");
+    reader_t rd = { countGrains(&w), 0, 0, 0 };
+    thread_t t;
+    CHECK(threadStart(&t, readLoop, &rd), "can't start reader");
+    for (int k = 0; k < 300 || (atomicLoad(&rd.snapshots) == 0 && k < 100000); k++) {
+        shareBegin(&s);
+        UpdateGrid(&w);
+        shareEnd(&s);
+        if (k % 8 == 0) threadYield();
+    }
+    atomicStore(&rd.done, 1);
+    threadJoin(&t);
+    CHECK(rd.snapshots > 0, "reader never got a snapshot");
+    CHECK(rd.torn == 0, "%d of %d snapshots torn", rd.torn, rd.snapshots);
+    shareClose(&s);
+    worldFree(&w);
+}
+
+int main() {
+    checkRoundTrip();
+    checkConcurrentReader();
+    return checkResult();
+}
@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "check.h"
+#include "sim.h"
+#include "stats.h"
+
+// feeds the counters made up frames and checks what they report and where the overlay draws
+
+static void checkPercentiles() {
+    world_t w;
+    worldInit(&w, 64, 64, 1);
+    stats_t s;
+    statsInit(&s, &w);
+    CHECK(statsPercentile(&s, 0.5) == 0, "percentile with no frames");
+    for (int f = 1; f <= 100; f++) {
+        statsFrame(&s, &w, 1, 0, 0, 0, f / 1000.0);
+    }
+    double p50 = statsPercentile(&s, 0.5), p99 = statsPercentile(&s, 0.99);
+    CHECK(p50 >= 49.9 && p50 <= 51.1, "p50 of 1..100 ms is %f", p50);
+    CHECK(p99 >= 98.9 && p99 <= 100.1, "p99 of 1..100 ms is %f", p99);
+
+    // only the last STATS_FRAMES are kept
+    for (int f = 101; f <= 400; f++) {
+        statsFrame(&s, &w, 1, 0, 0, 0, f / 1000.0);
+    }
+    double low = statsPercentile(&s, 0), high = statsPercentile(&s, 1);
+    CHECK(low > 400 - STATS_FRAMES + 0.9 && low < 400 - STATS_FRAMES + 1.1, "oldest kept frame %f ms", low);
+    CHECK(high > 399.9 && high < 400.1, "newest kept frame %f ms", high);
+    CHECK(s.frames == 400 && s.steps == 400, "%lld frames, %lld steps counted", s.frames, s.steps);
+    worldFree(&w);
+}
+
+static void checkRates() {
+    world_t w;
+    worldInit(&w, 64, 64, 1);
+    stats_t s;
+    statsInit(&s, &w);
+    for (int f = 0; f < 90; f++) {
+        statsFrame(&s, &w, 3, 0.002, 0.0005, 0.004, 1.0 / 60);
+    }
+    CHECK(s.stepRate > 179 && s.stepRate < 181, "3 updates a frame at 60 Hz counted as %f/s", s.stepRate);
+    CHECK(s.stepMs > 1.99 && s.stepMs < 2.01 && s.brushMs > 0.49 && s.brushMs < 0.51 && s.renderMs > 3.99
+          && s.renderMs < 4.01, "last frame costs %f %f %f ms", s.stepMs, s.brushMs, s.renderMs);
+    worldFree(&w);
+}
+
+// chunks written during a frame, and only those
+static void checkChunks() {
+    world_t w;
+    worldInit(&w, 4 * CHUNK_SIZE, 4 * CHUNK_SIZE, 1);
+    stats_t s;
+    statsInit(&s, &w);
+    CHECK(s.chunks == 16 && s.grains == 0, "%d chunks, %d grains in an empty world", s.chunks, s.grains);
+    particle_t p = { RGB(1, 2, 3), true, false, 0 };
+    set(&w, 0, 0, p);
+    set(&w, 1, 1, p);
+    set(&w, CHUNK_SIZE + 3, 2 * CHUNK_SIZE + 5, p);
+    statsFrame(&s, &w, 0, 0, 0, 0, 0.016);
+    CHECK(s.activeChunks == 2 && s.grains == 3, "%d chunks written, %d grains", s.activeChunks, s.grains);
+    statsFrame(&s, &w, 0, 0, 0, 0, 0.016);
+    CHECK(s.activeChunks == 0, "%d chunks written in a frame that wrote none", s.activeChunks);
+    worldFree(&w);
+}
+
+// the overlay stays inside its panel and inside the image, wherever it is put
+static void checkDraw() {
+    world_t w;
+    worldInit(&w, 64, 64, 1);
+    stats_t s;
+    statsInit(&s, &w);
+    for (int f = 0; f < 300; f++) {
+        statsFrame(&s, &w, 2, 0.001, 0, 0.003, (f % 50 ? 16 : 40) / 1000.0);
+    }
+    enum { WIDTH = 400, HEIGHT = 300, GUARD = 1024, SENTINEL = 0x123456 };
+    static const int PLACES[][2] = { { 10, 20 }, { 300, 250 }, { -100, -50 }, { 399, 299 } };
+    uint32_t* pixels = malloc((WIDTH * HEIGHT + GUARD) * sizeof(uint32_t));
+    for (int k = 0; k < 4; k++) {
+        for (int i = 0; i < WIDTH * HEIGHT + GUARD; i++) pixels[i] = SENTINEL;
+        int x = PLACES[k][0], y = PLACES[k][1];
+        statsDraw(&s, pixels, WIDTH, HEIGHT, x, y);
+        // the panel is no wider than the graph and its margins, and no taller than the image
+        bool inside = true;
+        for (int i = 0; i < HEIGHT; i++) {
+            for (int j = 0; j < WIDTH; j++) {
+                bool panel = j >= x && j < x + STATS_FRAMES + 12 && i >= y;
+                if (!panel && pixels[i * WIDTH + j] != SENTINEL) inside = false;
+            }
+        }
+        CHECK(inside, "overlay at (%d, %d) drew outside its panel", x, y);
+        bool guard = true;
+        for (int i = WIDTH * HEIGHT; i < WIDTH * HEIGHT + GUARD; i++) guard = guard && pixels[i] == SENTINEL;
+        CHECK(guard, "overlay at (%d, %d) drew past the image", x, y);
+    }
+    // on screen it shows something
+    for (int i = 0; i < WIDTH * HEIGHT; i++) pixels[i] = SENTINEL;
+    statsDraw(&s, pixels, WIDTH, HEIGHT, 0, 0);
+    int drawn = 0;
+    for (int i = 0; i < WIDTH * HEIGHT; i++) drawn += pixels[i] != SENTINEL && pixels[i] != ((SENTINEL >> 2) & 0x3F3F3F);
+    CHECK(drawn > 1000, "only %d pixels of text and graph", drawn);
+    free(pixels);
+    worldFree(&w);
+}
+
+int main() {
+    checkPercentiles();
+    checkRates();
+    checkChunks();
+    checkDraw();
+    return checkResult();
+}
@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "check.h"
+#include "net.h"
+#include "sim.h"
+#include "stream.h"
+
+// serves a world being poured into to a spectator over loopback, a keyframe and then a
+// delta per update, and checks the cells the spectator rebuilds against the world. then
+// keyframes whose size a spectator mustn't take
+
+enum { WIDTH = 150, HEIGHT = 100, UPDATES = 40, HASH_EVERY = 4 };
+
+// reads one frame from s into v, false if it didn't come or didn't apply
+static bool receive(net_socket_t s, view_t* v, frame_header_t* header) {
+    uint8_t raw[FRAME_HEADER_SIZE];
+    if (!netRecv(s, raw, sizeof(raw)) || !readFrameHeader(raw, header)) return false;
+    uint8_t* payload = malloc(header->bytes ? header->bytes : 1);
+    bool ok = netRecv(s, payload, header->bytes) && applyFrame(v, header, payload);
+    free(payload);
+    return ok;
+}
+
+int main() {
+    net_socket_t listener = netListen(NULL, 0);
+    int port = netLocalPort(listener);
+    CHECK(listener != NET_INVALID && port > 0, "can't listen on loopback");
+    if (listener == NET_INVALID) return checkResult();
+
+    net_socket_t spectator = netConnect("127.0.0.1", port);
+    net_socket_t server = netAccept(listener, 2000);
+    CHECK(spectator != NET_INVALID && server != NET_INVALID, "spectator didn't connect on port %d", port);
+    if (spectator == NET_INVALID || server == NET_INVALID) return checkResult();
+
+    world_t w;
+    worldInit(&w, WIDTH, HEIGHT, 7);
+    buffer_t frame = { 0 };
+    view_t view = { 0 };
+    encodeKeyframe(&w, &frame);
+    uint32_t since = nextEpoch(&w);
+    unsigned state = 99;
+    for (int u = 0; u <= UPDATES; u++) {
+        if (u > 0) {
+            // a few grains poured in along the top, then an update
+            for (int k = 0; k < 12; k++) {
+                state = state * 1664525u + 1013904223u;
+                int x = (state >> 8) % WIDTH;
+                if (!at(&w, 0, x).e) set(&w, 0, x, (particle_t) { RGB(x, u, 200), true, false, 0 });
+            }
+            UpdateGrid(&w);
+            frame.size = 0;
+            encodeDelta(&w, since, u % HASH_EVERY == 0, &frame);
+            since = nextEpoch(&w);
+        }
+        CHECK(netSend(server, frame.data, frame.size), "update %d wasn't sent", u);
+
+        frame_header_t header;
+        bool applied = receive(spectator, &view, &header);
+        CHECK(applied, "update %d wasn't received", u);
+        if (!applied) break;
+        CHECK(header.type == (u ? FRAME_DELTA : FRAME_KEY), "update %d came as frame type %u", u, header.type);
+        CHECK(view.width == WIDTH && view.height == HEIGHT, "view is %dx%d", view.width, view.height);
+        bool hashed = u % HASH_EVERY == 0;
+        CHECK(header.hashed == hashed, "update %d came %s", u, hashed ? "without a hash" : "hashed");
+        CHECK(!hashed || header.hash == hashWorld(&w), "update %d: frame hash isn't the world's", u);
+        CHECK(hashView(&view) == hashWorld(&w), "update %d: rebuilt cells differ from the world", u);
+    }
+    CHECK(countGrains(&w) > 0, "nothing was poured");
+
+    // sizes the view can't take leave it as it was
+    static const uint32_t SIZES[][2] = {
+        { 0, HEIGHT }, { WIDTH, 0 }, { FRAME_MAX_SIDE + 1, 1 }, { 1, 0xFFFFFFFFu }, { 0xFFFFFFFFu, 0xFFFFFFFFu },
+    };
+    for (int k = 0; k < 5; k++) {
+        frame_header_t bad = { FRAME_KEY, 0, SIZES[k][0], SIZES[k][1], 0, true, 0, 0 };
+        CHECK(!applyFrame(&view, &bad, NULL), "took a %ux%u keyframe", SIZES[k][0], SIZES[k][1]);
+        CHECK(view.width == WIDTH && view.height == HEIGHT && view.cells, "a %ux%u keyframe resized the view",
+              SIZES[k][0], SIZES[k][1]);
+    }
+
+    viewFree(&view);
+    bufferFree(&frame);
+    worldFree(&w);
+    netClose(spectator);
+    netClose(server);
+    netClose(listener);
+    return checkResult();
+}
@@ -0,0 +1,118 @@
+#ifndef SANDSIM_THREAD_H
+#define SANDSIM_THREAD_H
+
+#include <stdbool.h>
+
+// just enough of a thread api to run workers on both win32 and pthreads
+#ifdef _WIN32
+#include <windows.h>
+
+typedef struct thread {
+    HANDLE handle;
+    void* (*fn)(void*);
+    void* arg;
+} thread_t;
+
+static DWORD WINAPI threadEntry(LPVOID param) {
+    thread_t* t = param;
+    t->fn(t->arg);
+    return 0;
+}
+
+static inline bool threadStart(thread_t* t, void* (*fn)(void*), void* arg) {
+    t->fn = fn;
+    t->arg = arg;
+    t->handle = CreateThread(NULL, 0, threadEntry, t, 0, NULL);
+    return t->handle != NULL;
+}
+
+static inline void threadJoin(thread_t* t) {
+    WaitForSingleObject(t->handle, INFINITE);
+    CloseHandle(t->handle);
+}
+
+// give up the rest of this thread's time slice
+static inline void threadYield() {
+    SwitchToThread();
+}
+
+static inline int cpuCount() {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int) info.dwNumberOfProcessors;
+}
+
+// bytes of the largest cache, 8 MB if it can't be told
+static inline long cacheSize() {
+    SYSTEM_LOGICAL_PROCESSOR_INFORMATION info[256];
+    DWORD bytes = sizeof(info);
+    long largest = 0;
+    if (GetLogicalProcessorInformation(info, &bytes)) {
+        for (DWORD i = 0; i < bytes / sizeof(info[0]); i++) {
+            if (info[i].Relationship == RelationCache && (long) info[i].Cache.Size > largest) {
+                largest = (long) info[i].Cache.Size;
+            }
+        }
+    }
+    return largest > 0 ? largest : 8L << 20;
+}
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+typedef struct thread {
+    pthread_t handle;
+} thread_t;
+
+static inline bool threadStart(thread_t* t, void* (*fn)(void*), void* arg) {
+    return pthread_create(&t->handle, NULL, fn, arg) == 0;
+}
+
+static inline void threadJoin(thread_t* t) {
+    pthread_join(t->handle, NULL);
+}
+
+static inline void threadYield() {
+    sched_yield();
+}
+
+static inline int cpuCount() {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int) n : 1;
+}
+
+static inline long cacheSize() {
+    long largest = 0;
+#ifdef _SC_LEVEL3_CACHE_SIZE
+    largest = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    if (largest <= 0) largest = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+    return largest > 0 ? largest : 8L << 20;
+}
+#endif
+
+// shared counters between workers
+static inline int atomicAdd(int* p, int v) {
+    return __atomic_fetch_add(p, v, __ATOMIC_SEQ_CST);
+}
+
+static inline int atomicLoad(int* p) {
+    return __atomic_load_n(p, __ATOMIC_SEQ_CST);
+}
+
+static inline void atomicStore(int* p, int v) {
+    __atomic_store_n(p, v, __ATOMIC_SEQ_CST);
+}
+
+// keeps memory accesses from moving across it either way
+static inline void atomicFence() {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+// sets *p to v if it holds expected, returns whether it did
+static inline bool atomicSwap(int* p, int expected, int v) {
+    return __atomic_compare_exchange_n(p, &expected, v, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+#endif